@@ -46,6 +46,12 @@
 #	define LIBOPENCM3_DEPRECATED(x)
 #endif
 
+/* Functions with this attribute are linked to the .ramtext section, which the
+ * reset handler copies to RAM together with the initialised data, so they keep
+ * running while the flash is busy. RAM is out of branch range from the flash,
+ * so they are called through a register. */
+#define LIBOPENCM3_RAMFUNC __attribute__((section(".ramtext"), long_call))
+
 
 #if defined (__ASSEMBLER__)
 #define MMIO8(addr)	(addr)
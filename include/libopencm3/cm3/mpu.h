@@ -128,10 +128,59 @@
 /**@}*/
 /**@}*/
 
+/** @defgroup CM3_mpu_memtype MPU memory types
+ * @ingroup CM3_mpu_defines
+ * TEX, C and B encodings of the memory types. v6m only supports those with
+ * TEX = 0.
+ *@{*/
+#define MPU_MEM_STRONGLY_ORDERED	0 /**< No buffering, no reordering */
+#define MPU_MEM_DEVICE			MPU_RASR_ATTR_B /**< Shareable device */
+#define MPU_MEM_NORMAL_WT		MPU_RASR_ATTR_C /**< Write-through, no write allocate */
+#define MPU_MEM_NORMAL_WB		(MPU_RASR_ATTR_C | MPU_RASR_ATTR_B) /**< Write-back, no write allocate */
+#define MPU_MEM_NORMAL_NC		(1 << 19) /**< Normal, not cacheable */
+#define MPU_MEM_NORMAL_WBWA		((1 << 19) | MPU_RASR_ATTR_C | MPU_RASR_ATTR_B) /**< Write-back, write and read allocate */
+/**@}*/
+
+/** @defgroup CM3_mpu_presets MPU region presets
+ * @ingroup CM3_mpu_defines
+ * Complete attributes for mpu_set_region().
+ *@{*/
+/** DMA buffers and descriptors, never cached so no cache maintenance is needed */
+#define MPU_REGION_DMA_POOL		(MPU_MEM_NORMAL_NC | MPU_RASR_ATTR_S | \
+					 MPU_RASR_ATTR_AP_PRW_URW | MPU_RASR_ATTR_XN)
+/** SRAM with writes going straight to memory */
+#define MPU_REGION_SRAM_WT		(MPU_MEM_NORMAL_WT | MPU_RASR_ATTR_AP_PRW_URW)
+/** SRAM with the best performance */
+#define MPU_REGION_SRAM_WB		(MPU_MEM_NORMAL_WBWA | MPU_RASR_ATTR_AP_PRW_URW)
+/** Peripheral window, accesses in program order and never speculated */
+#define MPU_REGION_PERIPH		(MPU_MEM_STRONGLY_ORDERED | \
+					 MPU_RASR_ATTR_AP_PRW_URW | MPU_RASR_ATTR_XN)
+/** Stacks, cached but never executed */
+#define MPU_REGION_STACK_NX		(MPU_MEM_NORMAL_WBWA | \
+					 MPU_RASR_ATTR_AP_PRW_URW | MPU_RASR_ATTR_XN)
+/** Read only code, e.g. flash */
+#define MPU_REGION_CODE_RO		(MPU_MEM_NORMAL_WT | MPU_RASR_ATTR_AP_PRO_URO)
+/**@}*/
+
+/** Region geometry, see mpu_region_for_range() */
+struct mpu_region {
+	uint32_t base;		/**< base address, aligned to the size */
+	uint8_t size_log2;	/**< region size is 1 << size_log2 bytes */
+	uint8_t srd;		/**< disabled subregions, one bit per eighth */
+};
+
 /* --- MPU functions ------------------------------------------------------- */
 
 BEGIN_DECLS
 
+uint8_t mpu_get_region_count(void);
+void mpu_enable(uint32_t ctrl);
+void mpu_disable(void);
+bool mpu_region_for_range(struct mpu_region *region, uint32_t start,
+			  uint32_t end);
+void mpu_set_region(uint8_t number, const struct mpu_region *region,
+		    uint32_t attr);
+void mpu_clear_region(uint8_t number);
 
 END_DECLS
 
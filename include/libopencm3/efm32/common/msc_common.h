@@ -22,6 +22,7 @@
 #pragma once
 
 #include <libopencm3/efm32/memorymap.h>
+#include <libopencm3/efm32/dma.h>
 #include <libopencm3/cm3/common.h>
 
 /**@{*/
@@ -153,4 +154,24 @@
 #define MSC_MASSLOCK_LOCKKEY_LOCK	MSC_MASSLOCK_LOCKKEY(0)
 #define MSC_MASSLOCK_LOCKKEY_UNLOCK	MSC_MASSLOCK_LOCKKEY(0x631A)
 
-/**@}*/
\ No newline at end of file
+/* Building the library with -DLIBOPENCM3_FLASH_RAMFUNC places the erase and
+ * program functions in RAM, see LIBOPENCM3_RAMFUNC. */
+#if defined(LIBOPENCM3_FLASH_RAMFUNC)
+#define MSC_RAMFUNC		LIBOPENCM3_RAMFUNC
+#else
+#define MSC_RAMFUNC
+#endif
+
+BEGIN_DECLS
+
+void msc_unlock(void);
+void msc_lock(void);
+bool msc_erase_page(uint32_t address);
+bool msc_program_word(uint32_t address, uint32_t data);
+bool msc_program(uint32_t address, const uint32_t *data, uint32_t count);
+bool msc_program_dma(uint32_t desc_base, enum dma_ch ch, uint32_t address,
+		     const uint32_t *data, uint32_t count);
+
+END_DECLS
+
+/**@}*/
@@ -28,3 +28,6 @@
 #pragma once
 
 #include <libopencm3/efm32/common/msc_common.h>
+
+/* Flash page size, the erase unit */
+#define MSC_PAGE_SIZE		2048
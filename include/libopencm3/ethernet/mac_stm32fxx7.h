@@ -592,6 +592,24 @@
 
 #define ETH_DES_STD_SIZE		16
 #define ETH_DES_EXT_SIZE		32
+
+/* eth_desc_init() places every descriptor and buffer on whole cache lines of
+ * the Cortex-M7 data cache, so that cache maintenance on one never touches
+ * memory the DMA owns. Elsewhere words are enough. */
+#if defined(STM32F7)
+#define ETH_DESC_ALIGN			32
+#else
+#define ETH_DESC_ALIGN			4
+#endif
+#define ETH_DESC_ROUND(x)		\
+	(((x) + ETH_DESC_ALIGN - 1) & ~(ETH_DESC_ALIGN - 1))
+
+/* Bytes of memory eth_desc_init() needs */
+#define ETH_DESC_MEM_SIZE(nTx, nRx, cTx, cRx, isext)			\
+	((nTx) * (ETH_DESC_ROUND((isext) ? ETH_DES_EXT_SIZE :		\
+				 ETH_DES_STD_SIZE) + ETH_DESC_ROUND(cTx)) +	\
+	 (nRx) * (ETH_DESC_ROUND((isext) ? ETH_DES_EXT_SIZE :		\
+				 ETH_DES_STD_SIZE) + ETH_DESC_ROUND(cRx)))
 /*---------------------------------------------------------------------------*/
 /* TDES0 --------------------------------------------------------------------*/
 
@@ -768,7 +786,10 @@ END_DECLS
  *  phy_init(0);
  *  eth_init(0, ETH_CLK_025_035MHZ);
  *  eth_set_mac(mac);
- *  eth_desc_init(buffer, &eth_buffer[0], ETH_TXBUFNB, ETH_RXBUFNB,
+ *  static uint8_t eth_buffer[ETH_DESC_MEM_SIZE(ETH_TXBUFNB, ETH_RXBUFNB,
+ *		ETH_TX_BUF_SIZE, ETH_RX_BUF_SIZE, false)]
+ *		__attribute__((aligned(ETH_DESC_ALIGN)));
+ *  eth_desc_init(eth_buffer, ETH_TXBUFNB, ETH_RXBUFNB,
  *                  ETH_TX_BUF_SIZE, ETH_RX_BUF_SIZE, false);
  *  eth_start();
  *  for (;;)
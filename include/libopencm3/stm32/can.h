@@ -640,6 +640,46 @@ LGPL License Terms @ref lgpl_license
 
 /* FB[31:0]: Filter bits */
 
+/* --- Queued driver ------------------------------------------------------- */
+
+/** CAN frame, as used by can_queue_transmit() and can_queue_receive() */
+struct can_frame {
+	uint32_t id;
+	bool ext;		/**< extended (29 bit) identifier */
+	bool rtr;		/**< remote transmission request */
+	uint8_t length;
+	uint8_t fmi;		/**< filter match index, received frames only */
+	uint16_t timestamp;	/**< received frames only, needs TTCM */
+	uint8_t data[8];
+};
+
+/** Queued CAN driver, see can_queue_init() */
+struct can_queue {
+	uint32_t canport;
+	struct can_frame *tx_buf;	/**< TX queue, sorted by priority */
+	uint16_t tx_size;
+	volatile uint16_t tx_count;
+	struct can_frame *rx_buf;	/**< RX ring */
+	uint16_t rx_size;
+	volatile uint16_t rx_head;
+	volatile uint16_t rx_tail;
+	volatile uint32_t rx_overruns;	/**< frames dropped, RX ring full */
+	volatile uint32_t rx_fifo_overruns;	/**< frames lost in the FIFOs */
+	volatile uint32_t tx_errors;	/**< frames not sent, NART mode */
+	/* private state */
+	struct can_frame mbox[3];	/**< frames loaded into the mailboxes */
+	uint8_t mbox_abort;		/**< mailbox aborted for a better frame */
+};
+
+/* --- Filter planner ------------------------------------------------------ */
+
+/** Range of identifiers to accept, see can_filter_plan() */
+struct can_filter_range {
+	uint32_t first;
+	uint32_t last;		/**< inclusive, equal to first for a single id */
+	bool ext;		/**< extended (29 bit) identifiers */
+};
+
 /* --- CAN functions -------------------------------------------------------- */
 
 BEGIN_DECLS
@@ -662,6 +702,9 @@ void can_filter_id_list_16bit_init(uint32_t nr, uint16_t id1,
 				   uint32_t fifo, bool enable);
 void can_filter_id_list_32bit_init(uint32_t nr, uint32_t id1,
 				   uint32_t id2, uint32_t fifo, bool enable);
+int can_filter_plan(uint32_t first, uint32_t banks,
+		    const struct can_filter_range *ranges, uint32_t count,
+		    uint32_t fifo, bool *widened);
 
 void can_enable_irq(uint32_t canport, uint32_t irq);
 void can_disable_irq(uint32_t canport, uint32_t irq);
@@ -674,6 +717,16 @@ void can_receive(uint32_t canport, uint8_t fifo, bool release, uint32_t *id,
 
 void can_fifo_release(uint32_t canport, uint8_t fifo);
 bool can_available_mailbox(uint32_t canport);
+
+void can_queue_init(struct can_queue *queue, uint32_t canport,
+		    struct can_frame *tx_buf, uint16_t tx_size,
+		    struct can_frame *rx_buf, uint16_t rx_size);
+bool can_queue_transmit(struct can_queue *queue,
+			const struct can_frame *frame);
+bool can_queue_receive(struct can_queue *queue, struct can_frame *frame);
+uint16_t can_queue_rx_available(const struct can_queue *queue);
+void can_queue_tx_irq_handler(struct can_queue *queue);
+void can_queue_rx_irq_handler(struct can_queue *queue);
 END_DECLS
 
 /**@}*/
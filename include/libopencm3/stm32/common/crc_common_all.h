@@ -30,6 +30,8 @@ specific memorymap.h header before including this header file.*/
 #pragma once
 /**@{*/
 
+#include <stddef.h>
+
 /*****************************************************************************/
 /* Module definitions                                                        */
 /*****************************************************************************/
@@ -71,6 +73,43 @@ specific memorymap.h header before including this header file.*/
 #define CRC_CR_RESET			(1 << 0)
 /**@}*/
 
+/*****************************************************************************/
+/* API definitions                                                           */
+/*****************************************************************************/
+
+/**
+ * CRC algorithm parameters, as in the catalogue of parametrised CRC
+ * algorithms: the input and output are either both reflected or not.
+ */
+struct crc_params {
+	uint32_t poly;		/**< polynomial, without the top bit */
+	uint32_t init;		/**< initial register value */
+	uint32_t xorout;	/**< value xored into the final result */
+	uint8_t width;		/**< 7, 8, 16 or 32 bits */
+	bool reflect;		/**< bytes are processed LSB first */
+};
+
+/** CRC-32 (Ethernet, zlib), check value 0xCBF43926 */
+extern const struct crc_params crc_preset_crc32;
+/** CRC-16/CCITT-FALSE (CRC-16/IBM-3740), check value 0x29B1 */
+extern const struct crc_params crc_preset_crc16_ccitt;
+/** CRC-8 (CRC-8/SMBUS), check value 0xF4 */
+extern const struct crc_params crc_preset_crc8;
+
+/**
+ * Streaming CRC calculation, see crc_stream_init().
+ */
+struct crc_stream {
+	const struct crc_params *params;
+	uint32_t state;		/**< CRC register, never reflected */
+	/* private state of a DMA update */
+	uint32_t dma;
+	uint8_t ch;
+	const uint8_t *next;
+	size_t left;
+	size_t chunk;
+};
+
 BEGIN_DECLS
 
 
@@ -98,6 +137,67 @@ uint32_t crc_calculate(uint32_t data);
  */
 uint32_t crc_calculate_block(uint32_t *datap, int size);
 
+/**
+ * Start a streaming CRC calculation.
+ * @param[out] stream calculation state
+ * @param[in] params CRC algorithm, e.g. @ref crc_preset_crc32
+ */
+void crc_stream_init(struct crc_stream *stream,
+		     const struct crc_params *params);
+
+/**
+ * Add bytes to a streaming CRC calculation.
+ * The CRC unit is used where it supports the algorithm, otherwise the
+ * CRC is calculated in software. Any CRC unit configuration made with the
+ * other functions of this file is overwritten.
+ * @param[in] stream calculation state
+ * @param[in] data bytes to add, any alignment
+ * @param[in] len number of bytes
+ */
+void crc_stream_update(struct crc_stream *stream, const void *data,
+		       size_t len);
+
+/**
+ * Start adding bytes to a streaming CRC calculation by DMA.
+ * The DMA controller feeds the CRC unit with a memory to memory transfer,
+ * a few bytes at the ends of the buffer are added by the CPU. If the CRC
+ * unit doesn't support the algorithm or can't be fed by DMA (CRC units
+ * without byte access), the bytes are added by the CPU before returning.
+ * The CRC unit must not be used until crc_stream_dma_busy() returns false.
+ * @param[in] stream calculation state
+ * @param[in] data bytes to add, must stay valid until finished
+ * @param[in] len number of bytes
+ * @param[in] dma DMA controller, DMA2 on stream based controllers
+ * @param[in] ch DMA stream/channel
+ */
+void crc_stream_update_dma(struct crc_stream *stream, const void *data,
+			   size_t len, uint32_t dma, uint8_t ch);
+
+/**
+ * Check for the end of a DMA update and continue it.
+ * Can be polled or called from the interrupt of the DMA stream/channel.
+ * @param[in] stream calculation state
+ * @returns true while the DMA update is running
+ */
+bool crc_stream_dma_busy(struct crc_stream *stream);
+
+/**
+ * Finish a streaming CRC calculation.
+ * @param[in] stream calculation state
+ * @returns CRC of all bytes added
+ */
+uint32_t crc_stream_final(const struct crc_stream *stream);
+
+/**
+ * Calculate the CRC of a byte buffer.
+ * @param[in] params CRC algorithm, e.g. @ref crc_preset_crc32
+ * @param[in] data bytes, any alignment
+ * @param[in] len number of bytes
+ * @returns CRC of the buffer
+ */
+uint32_t crc_compute(const struct crc_params *params, const void *data,
+		     size_t len);
+
 END_DECLS
 
 /**@}*/
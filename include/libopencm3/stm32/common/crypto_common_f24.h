@@ -100,6 +100,8 @@ specific memorymap.h header before including this header file.*/
 #ifndef LIBOPENCM3_CRYPTO_COMMON_F24_H
 #define LIBOPENCM3_CRYPTO_COMMON_F24_H
 
+#include <stddef.h>
+
 /**@{*/
 
 /* --- CRYP registers ------------------------------------------------------ */
@@ -269,6 +271,27 @@ enum crypto_datatype {
 	CRYPTO_DATA_BIT,
 };
 
+/** Streaming encryption/decryption, see crypto_context_init() */
+struct crypto_context {
+	uint32_t cr;		/**< ALGOMODE, ALGODIR and KEYSIZE */
+	const uint8_t *key;	/**< must stay valid while the context is used */
+	uint8_t keylen;
+	uint8_t block;		/**< block size in bytes */
+	bool aead;		/**< GCM/CCM, hardware state kept between calls */
+	uint32_t iv[4];		/**< IV/counter, chained between calls */
+	size_t aadlen;
+	size_t msglen;
+	/* private state of a DMA transfer */
+	uint32_t dma;
+	uint8_t in_ch;
+	uint8_t out_ch;
+	const uint8_t *in;
+	uint8_t *out;
+	size_t left;
+	size_t chunk;
+	bool dma_error;
+};
+
 BEGIN_DECLS
 void crypto_wait_busy(void);
 void crypto_set_key(enum crypto_keysize keysize, uint64_t key[]);
@@ -278,6 +301,15 @@ void crypto_set_algorithm(enum crypto_mode mode);
 void crypto_start(void);
 void crypto_stop(void);
 uint32_t crypto_process_block(uint32_t *inp, uint32_t *outp, uint32_t length);
+void crypto_context_init(struct crypto_context *ctx, enum crypto_mode mode,
+			 const uint8_t *key, size_t keylen, const uint8_t *iv);
+void crypto_context_process(struct crypto_context *ctx, const void *in,
+			    void *out, size_t len);
+void crypto_context_process_dma(struct crypto_context *ctx, const void *in,
+				void *out, size_t len, uint32_t dma,
+				uint8_t in_ch, uint8_t out_ch);
+bool crypto_dma_busy(struct crypto_context *ctx);
+bool crypto_dma_error(const struct crypto_context *ctx);
 END_DECLS
 /**@}*/
 /**@}*/
@@ -32,6 +32,7 @@
  *
  */
 
+#include <libopencm3/cm3/common.h>
 #include <libopencm3/stm32/memorymap.h>
 #include <stdint.h>
 
@@ -141,7 +142,7 @@
 /** DMA2D Output PFC Control Register */
 #define DMA2D_OPFCCR			MMIO32(DMA2D_BASE + 0x34U)
 #define DMA2D_OPFCCR_CM_SHIFT		0
-#define DMA2D_OPFCCR_CM_MASK		0x3
+#define DMA2D_OPFCCR_CM_MASK		0x7
 #define DMA2D_OPFCCR_CM_ARGB8888	0
 #define DMA2D_OPFCCR_CM_RGB888		1
 #define DMA2D_OPFCCR_CM_RGB565		2
@@ -184,5 +185,65 @@
 /** DMA2D Background Color Lookup table */
 #define DMA2D_BG_CLUT			(uint32_t *)(DMA2D_BASE + 0x800U)
 
+/** DMA2D memory buffer description.
+ * Describes the source or destination area of a transfer. Offsets are given
+ * in pixels and are added at the end of each line, so a window of width w in
+ * a framebuffer of width fb_w has an offset of (fb_w - w).
+ */
+struct dma2d_buffer {
+	uint32_t addr;		/**< address of the first (top left) pixel */
+	uint16_t offset;	/**< line offset, in pixels */
+	uint8_t cm;		/**< colour mode, DMA2D_xPFCCR_CM_* */
+	uint8_t am;		/**< alpha mode, DMA2D_xPFCCR_AM_* (fg/bg only) */
+	uint8_t alpha;		/**< constant alpha (fg/bg only) */
+};
+
+/** DMA2D queued operation status */
+enum dma2d_op_status {
+	DMA2D_OP_PENDING,
+	DMA2D_OP_DONE,
+	DMA2D_OP_ERROR,
+};
+
+struct dma2d_op;
+typedef void (*dma2d_op_callback)(struct dma2d_op *op);
+
+/** DMA2D operation descriptor.
+ * Descriptors passed to dma2d_submit() are owned by the driver until their
+ * callback has been called (or status is no longer DMA2D_OP_PENDING).
+ */
+struct dma2d_op {
+	uint8_t mode;		/**< DMA2D_CR_MODE_* */
+	uint16_t width;		/**< pixels per line */
+	uint16_t height;	/**< number of lines */
+	uint32_t color;		/**< R2M fill colour, in output colour mode */
+	struct dma2d_buffer out;
+	struct dma2d_buffer fg;
+	struct dma2d_buffer bg;
+	dma2d_op_callback callback;	/**< called from the DMA2D irq, or NULL */
+	volatile enum dma2d_op_status status;
+	struct dma2d_op *next;	/**< private, used by the queue */
+};
+
+BEGIN_DECLS
+
+void dma2d_setup_op(const struct dma2d_op *op);
+void dma2d_start(void);
+void dma2d_abort(void);
+bool dma2d_is_busy(void);
+void dma2d_wait(void);
+
+void dma2d_fill(const struct dma2d_buffer *out, uint16_t width,
+		uint16_t height, uint32_t color);
+void dma2d_copy(const struct dma2d_buffer *out, const struct dma2d_buffer *fg,
+		uint16_t width, uint16_t height);
+void dma2d_blend(const struct dma2d_buffer *out, const struct dma2d_buffer *fg,
+		 const struct dma2d_buffer *bg, uint16_t width, uint16_t height);
+
+void dma2d_submit(struct dma2d_op *op);
+void dma2d_irq_handler(void);
+
+END_DECLS
+
 /**@}*/
 #endif
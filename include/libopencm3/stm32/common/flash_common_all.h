@@ -71,4 +71,6 @@ void flash_unlock(void);
  */
 void flash_unlock_option_bytes(void);
 
-END_DECLS
\ No newline at end of file
+END_DECLS
+
+#include <libopencm3/stm32/common/flash_common_kv.h>
@@ -0,0 +1,48 @@
+/** @addtogroup flash_defines
+ *
+ */
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* THIS FILE SHOULD NOT BE INCLUDED DIRECTLY, BUT ONLY VIA FLASH.H */
+
+#pragma once
+
+#include <libopencm3/cm3/common.h>
+
+/** Update of the inactive flash bank, see flash_update_start() */
+struct flash_update {
+	uint32_t address;	/**< start of the inactive bank */
+	uint32_t size;		/**< size of a bank in bytes */
+	uint32_t written;	/**< bytes programmed so far */
+	uint8_t bank;		/**< physical bank being updated, 1 or 2 */
+	bool erasing;		/**< bank erase started, not yet completed */
+};
+
+BEGIN_DECLS
+
+bool flash_dualbank_enabled(void);
+uint8_t flash_bank_active(void);
+bool flash_update_start(struct flash_update *update);
+bool flash_update_busy(struct flash_update *update);
+bool flash_update_write(struct flash_update *update, const uint8_t *data,
+			uint32_t len);
+bool flash_update_verify(struct flash_update *update, uint32_t len,
+			 uint32_t crc);
+void flash_update_swap(struct flash_update *update);
+
+END_DECLS
@@ -141,6 +141,16 @@
 #define FLASH_OPTKEYR_KEY1		((uint32_t)0x08192a3b)
 #define FLASH_OPTKEYR_KEY2		((uint32_t)0x4c5d6e7f)
 
+/* --- RAM resident operations -------------------------------------------- */
+
+/* Building the library with -DLIBOPENCM3_FLASH_RAMFUNC places the erase and
+ * program functions in RAM, see LIBOPENCM3_RAMFUNC. */
+#if defined(LIBOPENCM3_FLASH_RAMFUNC)
+#define FLASH_RAMFUNC		LIBOPENCM3_RAMFUNC
+#else
+#define FLASH_RAMFUNC
+#endif
+
 /* --- Function prototypes ------------------------------------------------- */
 
 BEGIN_DECLS
@@ -155,6 +165,8 @@ void flash_program_double_word(uint32_t address, uint64_t data);
 void flash_program_word(uint32_t address, uint32_t data);
 void flash_program_half_word(uint32_t address, uint16_t data);
 void flash_program_byte(uint32_t address, uint8_t data);
+void flash_set_program_parallelism(uint32_t program_size);
+uint32_t flash_get_program_parallelism(void);
 void flash_program(uint32_t address, const uint8_t *data, uint32_t len);
 void flash_program_option_bytes(uint32_t data);
 
@@ -57,6 +57,16 @@ void flash_dcache_reset(void);
  */
 void flash_icache_reset(void);
 
+/** Set the flash wait states and accelerator policy.
+ * The caches are disabled and reset before the latency changes and enabled
+ * again once the new latency is effective, so they never return lines fetched
+ * with the old setting.
+ * @param[in] ws number of wait states
+ * @param[in] policy any of FLASH_ACR_PRFTEN, FLASH_ACR_ICEN, FLASH_ACR_DCEN,
+ * other bits are ignored
+ */
+void flash_set_cache_policy(uint32_t ws, uint32_t policy);
+
 END_DECLS
 /**@}*/
 
@@ -0,0 +1,73 @@
+/** @addtogroup flash_defines
+ *
+ */
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* THIS FILE SHOULD NOT BE INCLUDED DIRECTLY, BUT ONLY VIA FLASH.H */
+
+#pragma once
+
+#include <stddef.h>
+#include <libopencm3/cm3/common.h>
+
+/** Flash area used by the key-value store: one erasable page or sector */
+struct flash_kv_area {
+	uint32_t address;	/**< start address */
+	uint32_t size;		/**< size in bytes */
+	/** sector number on F2/F4/F7, page number on G0/G4/L4, unused on
+	 * F0/F1/F3 where the page at address is erased */
+	uint32_t erase_id;
+};
+
+/** Key-value store index entry, caller owned, see flash_kv_init() */
+struct flash_kv_entry {
+	uint16_t key;
+	uint32_t addr;		/**< record address, 0 if deleted */
+};
+
+/** Log structured key-value store, see flash_kv_init() */
+struct flash_kv {
+	const struct flash_kv_area *areas;
+	uint8_t nareas;
+	uint8_t active;		/**< area holding the log */
+	uint32_t pending;	/**< areas waiting to be erased, bit per area */
+	uint32_t seq;		/**< sequence number of the active area */
+	uint32_t write;		/**< address of the next record */
+	uint32_t live;		/**< bytes of records still in use */
+	struct flash_kv_entry *index;
+	uint16_t index_size;
+};
+
+/** Reserved key, the value of erased flash */
+#define FLASH_KV_KEY_INVALID	0xffff
+/** Longest value */
+#define FLASH_KV_MAX_LEN	0x7fff
+
+BEGIN_DECLS
+
+bool flash_kv_init(struct flash_kv *kv, const struct flash_kv_area *areas,
+		   uint8_t nareas, struct flash_kv_entry *index,
+		   uint16_t index_size);
+int flash_kv_read(struct flash_kv *kv, uint16_t key, void *buf, size_t size);
+bool flash_kv_write(struct flash_kv *kv, uint16_t key, const void *data,
+		    size_t len);
+bool flash_kv_delete(struct flash_kv *kv, uint16_t key);
+bool flash_kv_poll(struct flash_kv *kv);
+bool flash_kv_nmi_handler(void);
+
+END_DECLS
@@ -31,6 +31,8 @@
 #ifndef LIBOPENCM3_HASH_COMMON_F24_H
 #define LIBOPENCM3_HASH_COMMON_F24_H
 
+#include <stddef.h>
+
 /* --- Convenience macros -------------------------------------------------- */
 
 /****************************************************************************/
@@ -156,6 +158,20 @@
 /* BUSY: Busy bit */
 #define HASH_SR_BUSY		(1 << 3)
 
+/* --- Streaming API ------------------------------------------------------- */
+
+/** HASH streaming calculation, see hash_start() */
+struct hash_context {
+	uint32_t cr;		/**< algorithm and mode */
+	const uint8_t *key;	/**< HMAC key, needed until hash_finish() */
+	size_t keylen;
+	uint32_t partial;	/**< bytes of an incomplete word */
+	uint8_t npartial;
+	uint8_t phase;
+	uint32_t dma;
+	uint8_t ch;
+};
+
 /* --- HASH function prototypes -------------------------------------------- */
 
 BEGIN_DECLS
@@ -170,6 +186,15 @@ void hash_add_data(uint32_t data);
 void hash_digest(void);
 void hash_get_result(uint32_t *data);
 
+void hash_start(struct hash_context *ctx, uint8_t algorithm);
+void hash_hmac_start(struct hash_context *ctx, uint8_t algorithm,
+		     const uint8_t *key, size_t keylen);
+void hash_update(struct hash_context *ctx, const void *data, size_t len);
+void hash_finish_dma(struct hash_context *ctx, const void *data, size_t len,
+		     uint32_t dma, uint8_t ch);
+bool hash_dma_busy(struct hash_context *ctx);
+bool hash_finish(struct hash_context *ctx, uint32_t *digest);
+
 END_DECLS
 /**@}*/
 #endif
@@ -0,0 +1,103 @@
+/** @addtogroup i2c_defines
+ *
+ */
+
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* THIS FILE SHOULD NOT BE INCLUDED DIRECTLY, BUT ONLY VIA I2C.H
+The order of header inclusion is important. i2c.h includes the device
+specific memorymap.h header before including this header file.*/
+
+/**@{*/
+
+/** @cond */
+#ifdef LIBOPENCM3_I2C_H
+/** @endcond */
+#ifndef LIBOPENCM3_I2C_COMMON_ALL_H
+#define LIBOPENCM3_I2C_COMMON_ALL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* --- Non blocking transfer queue ----------------------------------------- */
+
+/** I2C queued transfer status */
+enum i2c_transfer_status {
+	I2C_TRANSFER_PENDING,
+	I2C_TRANSFER_DONE,
+	I2C_TRANSFER_NACK,	/**< address or data not acknowledged */
+	I2C_TRANSFER_ARLO,	/**< arbitration lost */
+	I2C_TRANSFER_BUS_ERROR,	/**< misplaced start/stop, overrun */
+	I2C_TRANSFER_TIMEOUT,	/**< bus timeout or i2c_transfer_abort() */
+};
+
+struct i2c_transfer;
+typedef void (*i2c_transfer_callback)(struct i2c_transfer *xfer);
+
+/** I2C transfer descriptor.
+ * The write phase (if wn != 0) is followed by the read phase (if rn != 0)
+ * with a repeated start, as for i2c_transfer7(). Descriptors passed to
+ * i2c_transfer_submit() are owned by the driver until their status is no
+ * longer I2C_TRANSFER_PENDING.
+ */
+struct i2c_transfer {
+	uint8_t addr;		/**< 7 bit slave address */
+	const uint8_t *w;	/**< data to write */
+	size_t wn;		/**< number of bytes to write */
+	uint8_t *r;		/**< buffer for read data */
+	size_t rn;		/**< number of bytes to read */
+	i2c_transfer_callback callback;	/**< called from the I2C irq, or NULL */
+	volatile enum i2c_transfer_status status;
+	struct i2c_transfer *next;	/**< private, used by the queue */
+};
+
+/** I2C transfer queue, see i2c_transfer_queue_init() */
+struct i2c_transfer_queue {
+	uint32_t i2c;
+	uint32_t dma;		/**< DMA controller, 0 if interrupt driven */
+	uint8_t tx_ch;
+	uint8_t rx_ch;
+	struct i2c_transfer *volatile head;
+	struct i2c_transfer *tail;
+	/* private state of the running transfer */
+	size_t pos;
+	size_t left;
+	uint8_t state;
+	uint8_t error;
+};
+
+BEGIN_DECLS
+
+void i2c_transfer_queue_init(struct i2c_transfer_queue *queue, uint32_t i2c);
+void i2c_transfer_queue_set_dma(struct i2c_transfer_queue *queue,
+				uint32_t dma, uint8_t tx_ch, uint8_t rx_ch);
+void i2c_transfer_submit(struct i2c_transfer_queue *queue,
+			 struct i2c_transfer *xfer);
+bool i2c_transfer_queue_busy(const struct i2c_transfer_queue *queue);
+void i2c_transfer_irq_handler(struct i2c_transfer_queue *queue);
+void i2c_transfer_abort(struct i2c_transfer_queue *queue);
+
+END_DECLS
+
+#endif
+/** @cond */
+#else
+#warning "i2c_common_all.h should not be included explicitly, only via i2c.h"
+#endif
+/** @endcond */
+/**@}*/
@@ -36,6 +36,7 @@ specific memorymap.h header before including this header file.*/
 
 #include <stddef.h>
 #include <stdint.h>
+#include <libopencm3/stm32/common/i2c_common_all.h>
 
 /* --- Convenience macros -------------------------------------------------- */
 
@@ -417,6 +418,7 @@ void i2c_set_dma_last_transfer(uint32_t i2c);
 void i2c_clear_dma_last_transfer(uint32_t i2c);
 void i2c_transfer7(uint32_t i2c, uint8_t addr, const uint8_t *w, size_t wn, uint8_t *r, size_t rn);
 void i2c_set_speed(uint32_t i2c, enum i2c_speeds speed, uint32_t clock_megahz);
+void i2c_transfer_dma_irq_handler(struct i2c_transfer_queue *queue);
 
 END_DECLS
 
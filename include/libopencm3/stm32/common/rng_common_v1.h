@@ -29,6 +29,7 @@ specific memorymap.h header before including this header file.*/
 #define LIBOPENCM3_RNG_V1_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**@{*/
@@ -69,6 +70,29 @@ specific memorymap.h header before including this header file.*/
 /* Seed error interrupt status */
 #define RNG_SR_SEIS		(1 << 6)
 
+/* --- Entropy pool ------------------------------------------------------- */
+
+/** Interrupt filled entropy pool, see rng_pool_init() */
+struct rng_pool {
+	uint32_t *buf;		/**< caller owned storage */
+	uint16_t size;		/**< number of words in buf */
+	volatile uint16_t head;
+	volatile uint16_t tail;
+	volatile bool failed;	/**< health tests failed repeatedly */
+	uint32_t seed_errors;
+	uint32_t clock_errors;
+	uint32_t health_failures;
+	/* private health test state */
+	bool discard;
+	uint32_t last;
+	uint8_t rct_sample;
+	uint16_t rct_count;
+	uint8_t apt_sample;
+	uint16_t apt_count;
+	uint16_t apt_index;
+	uint8_t restarts;
+};
+
 /* --- Function prototypes ------------------------------------------------- */
 
 BEGIN_DECLS
@@ -79,6 +103,10 @@ void rng_interrupt_enable(void);
 void rng_interrupt_disable(void);
 bool rng_get_random(uint32_t *rand_nr);
 uint32_t rng_get_random_blocking(void);
+void rng_pool_init(struct rng_pool *pool, uint32_t *buf, uint16_t size);
+void rng_pool_irq_handler(struct rng_pool *pool);
+size_t rng_pool_available(const struct rng_pool *pool);
+size_t rng_fill(struct rng_pool *pool, void *buf, size_t len);
 
 END_DECLS
 
@@ -340,6 +340,43 @@ specific memorymap.h header before including this header file.*/
 /* I2SDIV[7:0]: I2S linear prescaler */
 /* 0 and 1 are forbidden values */
 
+/* --- DMA transfer queue ------------------------------------------------- */
+
+/** SPI queued transfer status */
+enum spi_transfer_status {
+	SPI_TRANSFER_PENDING,
+	SPI_TRANSFER_DONE,
+	SPI_TRANSFER_ERROR,
+};
+
+struct spi_transfer;
+typedef void (*spi_transfer_callback)(struct spi_transfer *xfer);
+
+/** SPI transfer descriptor.
+ * Descriptors passed to spi_transfer_submit() are owned by the driver until
+ * their status is no longer SPI_TRANSFER_PENDING.
+ */
+struct spi_transfer {
+	uint32_t cs_port;	/**< chip select GPIO port, 0 if unmanaged */
+	uint16_t cs_pin;	/**< chip select GPIO pin(s), active low */
+	const void *tx_buf;	/**< frames to send, NULL to send all ones */
+	void *rx_buf;		/**< received frames, NULL to discard them */
+	uint16_t len;		/**< number of frames, must not be 0 */
+	spi_transfer_callback callback;	/**< called from the DMA irq, or NULL */
+	volatile enum spi_transfer_status status;
+	struct spi_transfer *next;	/**< private, used by the queue */
+};
+
+/** SPI DMA transfer queue, see spi_transfer_queue_init() */
+struct spi_transfer_queue {
+	uint32_t spi;
+	uint32_t dma;
+	uint8_t tx_ch;
+	uint8_t rx_ch;
+	struct spi_transfer *volatile head;
+	struct spi_transfer *tail;
+};
+
 /* --- Function prototypes ------------------------------------------------- */
 
 BEGIN_DECLS
@@ -389,6 +426,13 @@ void spi_enable_rx_dma(uint32_t spi);
 void spi_disable_rx_dma(uint32_t spi);
 void spi_set_standard_mode(uint32_t spi, uint8_t mode);
 
+void spi_transfer_queue_init(struct spi_transfer_queue *queue, uint32_t spi,
+			     uint32_t dma, uint8_t tx_ch, uint8_t rx_ch);
+void spi_transfer_submit(struct spi_transfer_queue *queue,
+			 struct spi_transfer *xfer);
+bool spi_transfer_queue_busy(const struct spi_transfer_queue *queue);
+void spi_transfer_dma_irq_handler(struct spi_transfer_queue *queue);
+
 END_DECLS
 
 /**@}*/
@@ -36,6 +36,12 @@ specific memorymap.h header before including this header file.*/
 #define SPI2_DR8		SPI_DR8(SPI2_BASE)
 #define SPI3_DR8		SPI_DR8(SPI3_BASE)
 
+/* 16 bit access packs two 8 bit frames into one FIFO access */
+#define SPI_DR16(spi_base)	MMIO16((spi_base) + 0x0c)
+#define SPI1_DR16		SPI_DR16(SPI1_BASE)
+#define SPI2_DR16		SPI_DR16(SPI2_BASE)
+#define SPI3_DR16		SPI_DR16(SPI3_BASE)
+
 /* CRCL: CRC Length */
 /****************************************************************************/
 /** @defgroup spi_crcl SPI crc length
@@ -120,6 +126,10 @@ void spi_fifo_reception_threshold_16bit(uint32_t spi);
 void spi_i2s_mode_spi_mode(uint32_t spi);
 void spi_send8(uint32_t spi, uint8_t data);
 uint8_t spi_read8(uint32_t spi);
+void spi_xfer8_block(uint32_t spi, const uint8_t *tx, uint8_t *rx,
+		     uint32_t len);
+void spi_xfer16_block(uint32_t spi, const uint16_t *tx, uint16_t *rx,
+		      uint32_t len);
 
 END_DECLS
 
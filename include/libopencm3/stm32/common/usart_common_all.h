@@ -34,6 +34,7 @@ specific memorymap.h header before including this header file.*/
 #ifndef LIBOPENCM3_USART_COMMON_ALL_H
 #define LIBOPENCM3_USART_COMMON_ALL_H
 
+#include <stddef.h>
 
 /* --- Convenience defines ------------------------------------------------- */
 
@@ -94,6 +95,31 @@ specific memorymap.h header before including this header file.*/
 /**@}*/
 #define USART_FLOWCONTROL_MASK	        (USART_CR3_RTSE | USART_CR3_CTSE)
 
+/* --- DMA buffered port -------------------------------------------------- */
+
+struct usart_buffered;
+typedef void (*usart_buffered_rx_callback)(struct usart_buffered *port,
+					   size_t available);
+
+/** USART DMA buffered port, see usart_buffered_init() */
+struct usart_buffered {
+	uint32_t usart;
+	uint32_t dma;
+	uint8_t tx_ch;
+	uint8_t rx_ch;
+	uint8_t *rx_buf;	/**< RX ring, written by circular DMA */
+	uint16_t rx_size;
+	uint16_t rx_tail;	/**< next byte to be read */
+	uint8_t *tx_buf;	/**< TX ring */
+	uint16_t tx_size;
+	volatile uint16_t tx_head;	/**< next free byte */
+	volatile uint16_t tx_tail;	/**< first byte not yet sent */
+	volatile uint16_t tx_dma_len;	/**< bytes owned by the TX DMA */
+	/** Called from interrupt context when received data is available */
+	usart_buffered_rx_callback rx_callback;
+	volatile uint32_t rx_errors;	/**< overrun/framing/noise/parity */
+};
+
 /* --- Function prototypes ------------------------------------------------- */
 
 BEGIN_DECLS
@@ -128,6 +154,22 @@ void usart_enable_error_interrupt(uint32_t usart);
 void usart_disable_error_interrupt(uint32_t usart);
 bool usart_get_flag(uint32_t usart, uint32_t flag);
 
+void usart_buffered_init(struct usart_buffered *port, uint32_t usart,
+			 uint32_t dma, uint8_t tx_ch, uint8_t rx_ch);
+void usart_buffered_set_tx_buffer(struct usart_buffered *port, uint8_t *buf,
+				  uint16_t size);
+void usart_buffered_start_rx(struct usart_buffered *port, uint8_t *buf,
+			     uint16_t size);
+size_t usart_buffered_rx_available(const struct usart_buffered *port);
+size_t usart_buffered_read(struct usart_buffered *port, uint8_t *data,
+			   size_t len);
+size_t usart_buffered_write(struct usart_buffered *port, const uint8_t *data,
+			    size_t len);
+bool usart_buffered_tx_busy(const struct usart_buffered *port);
+void usart_buffered_irq_handler(struct usart_buffered *port);
+void usart_buffered_rx_dma_irq_handler(struct usart_buffered *port);
+void usart_buffered_tx_dma_irq_handler(struct usart_buffered *port);
+
 END_DECLS
 
 #endif
@@ -80,6 +80,10 @@ typedef enum {
 #define USART_ISR_TXFE BIT23
 /** SPI Slave Underrun Flag. */
 #define USART_ISR_UDR BIT13
+/** RX FIFO Not Empty Flag (RXNE with FIFOs enabled). */
+#define USART_ISR_RXFNE USART_ISR_RXNE
+/** TX FIFO Not Full Flag (TXE with FIFOs enabled). */
+#define USART_ISR_TXFNF USART_ISR_TXE
 /**@}*/
 
 /** @addtogroup usart_icr_values
@@ -90,6 +94,21 @@ typedef enum {
 #define USART_ICR_TXFECF BIT5
 /**@}*/
 
+/** Interrupt driven FIFO port, see usart_fifo_port_init(). */
+struct usart_fifo_port {
+  uint32_t usart;
+  uint8_t *rx_buf;
+  uint16_t rx_size;
+  volatile uint16_t rx_head;
+  volatile uint16_t rx_tail;
+  uint8_t *tx_buf;
+  uint16_t tx_size;
+  volatile uint16_t tx_head;
+  volatile uint16_t tx_tail;
+  /** Bytes dropped because the RX ring was full. */
+  volatile uint32_t rx_overruns;
+};
+
 BEGIN_DECLS
 
 /** @defgroup usart_file USART peripheral API
@@ -160,6 +179,66 @@ void usart_disable_rx_fifo_threshold_interrupt(uint32_t usart);
  */
 void usart_set_rx_fifo_threshold(uint32_t usart,
          usart_fifo_threshold_t threshold);
+/**
+ * Write as many bytes as the TX FIFO accepts without waiting.
+ * @param[in] usart  Base address of USART, FIFOs must be enabled.
+ * @param[in] data  Bytes to send.
+ * @param[in] len  Number of bytes.
+ * @returns Number of bytes written to the TX FIFO.
+ */
+size_t usart_send_fifo(uint32_t usart, const uint8_t *data, size_t len);
+/**
+ * Read as many bytes as the RX FIFO holds without waiting.
+ * @param[in] usart  Base address of USART, FIFOs must be enabled.
+ * @param[out] data  Destination.
+ * @param[in] len  Maximum number of bytes.
+ * @returns Number of bytes read from the RX FIFO.
+ */
+size_t usart_recv_fifo(uint32_t usart, uint8_t *data, size_t len);
+/**
+ * Set up an interrupt driven FIFO port on the specified USART.
+ * The FIFOs are enabled with RX threshold at 3/4 and TX threshold at half
+ * (changeable afterwards with usart_set_rx_fifo_threshold() and
+ * usart_set_tx_fifo_threshold()). Received data is moved to the RX ring on
+ * the RX FIFO threshold and idle line interrupts, the TX FIFO is refilled
+ * from the TX ring on the TX FIFO threshold interrupt, so every interrupt
+ * moves several characters. The USART must be configured and the USART
+ * interrupt enabled in the NVIC, calling usart_fifo_port_irq_handler().
+ * An already enabled USART is briefly disabled, after the last transmission
+ * completed, as the FIFOs can only be enabled while UE is cleared.
+ * @param[in] port  Port to initialise.
+ * @param[in] usart  Base address of USART.
+ * @param[in] rx_buf  RX ring storage.
+ * @param[in] rx_size  Size of rx_buf, one byte of it is never used.
+ * @param[in] tx_buf  TX ring storage.
+ * @param[in] tx_size  Size of tx_buf, one byte of it is never used.
+ */
+void usart_fifo_port_init(struct usart_fifo_port *port, uint32_t usart,
+         uint8_t *rx_buf, uint16_t rx_size,
+         uint8_t *tx_buf, uint16_t tx_size);
+/**
+ * Read received bytes from the RX ring of a FIFO port.
+ * @param[in] port  FIFO port.
+ * @param[out] data  Destination.
+ * @param[in] len  Maximum number of bytes.
+ * @returns Number of bytes read.
+ */
+size_t usart_fifo_port_read(struct usart_fifo_port *port, uint8_t *data,
+         size_t len);
+/**
+ * Queue bytes into the TX ring of a FIFO port.
+ * @param[in] port  FIFO port.
+ * @param[in] data  Bytes to send.
+ * @param[in] len  Number of bytes.
+ * @returns Number of bytes queued.
+ */
+size_t usart_fifo_port_write(struct usart_fifo_port *port,
+         const uint8_t *data, size_t len);
+/**
+ * Interrupt handler of a FIFO port, to be called from the USART interrupt.
+ * @param[in] port  FIFO port.
+ */
+void usart_fifo_port_irq_handler(struct usart_fifo_port *port);
 /**@}*/
 END_DECLS
 
@@ -38,6 +38,8 @@
 #       include <libopencm3/stm32/l1/crc.h>
 #elif defined(STM32L4)
 #       include <libopencm3/stm32/l4/crc.h>
+#elif defined(STM32G4)
+#       include <libopencm3/stm32/g4/crc.h>
 #elif defined(STM32G0)
 #       include <libopencm3/stm32/g0/crc.h>
 #else
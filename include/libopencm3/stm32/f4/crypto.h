@@ -90,6 +90,12 @@ BEGIN_DECLS
 
 void crypto_context_swap(uint32_t *buf);
 void crypto_set_mac_algorithm(enum crypto_mode_mac mode);
+void crypto_aead_start(struct crypto_context *ctx, enum crypto_mode_mac mode,
+		       const uint8_t *key, size_t keylen,
+		       const uint8_t *nonce, size_t noncelen,
+		       const uint8_t *aad, size_t aadlen,
+		       size_t msglen, size_t taglen);
+bool crypto_aead_finish(struct crypto_context *ctx, uint8_t *tag);
 
 END_DECLS
 /**@}*/
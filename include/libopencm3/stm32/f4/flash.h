@@ -35,8 +35,14 @@
 #include <libopencm3/stm32/common/flash_common_f.h>
 #include <libopencm3/stm32/common/flash_common_f24.h>
 
+#include <libopencm3/stm32/common/flash_common_dualbank.h>
+
 #define FLASH_SR_PGSERR			(1 << 7)
+/* Dual bank parts (F42x/F43x/F469/F479) only */
+#define FLASH_CR_MER1			(1 << 15)
+#define FLASH_OPTCR_DB1M		(1 << 30)
 #define FLASH_OPTCR_WDG_SW		(1 << 5)
+#define FLASH_OPTCR_BFB2		(1 << 4)
 
 BEGIN_DECLS
 
@@ -825,6 +825,14 @@ extern const struct rcc_clock_scale rcc_hse_12mhz_3v3[RCC_CLOCK_3V3_END];
 extern const struct rcc_clock_scale rcc_hse_16mhz_3v3[RCC_CLOCK_3V3_END];
 extern const struct rcc_clock_scale rcc_hse_25mhz_3v3[RCC_CLOCK_3V3_END];
 
+/** Clock change events, see rcc_clock_listener_register() */
+enum rcc_clock_change {
+	RCC_CLOCK_CHANGE_PRE,	/**< clocks about to change */
+	RCC_CLOCK_CHANGE_POST,	/**< clocks and rcc_*_frequency updated */
+};
+
+typedef void (*rcc_clock_listener)(enum rcc_clock_change event);
+
 enum rcc_osc {
 	RCC_PLL,
 	RCC_PLLSAI,
@@ -1130,6 +1138,13 @@ void rcc_set_main_pll_hse(uint32_t pllm, uint32_t plln, uint32_t pllp,
 			  uint32_t pllq, uint32_t pllr);
 uint32_t rcc_system_clock_source(void);
 void rcc_clock_setup_pll(const struct rcc_clock_scale *clock);
+bool rcc_clock_scale_solve(struct rcc_clock_scale *clock,
+			   uint32_t hse_frequency, uint32_t sysclk_frequency,
+			   bool usb48, enum pwr_vos_scale voltage_scale,
+			   uint32_t vdd_mv);
+int rcc_clock_listener_register(rcc_clock_listener listener);
+void rcc_clock_listener_unregister(rcc_clock_listener listener);
+void rcc_clock_switch(const struct rcc_clock_scale *clock);
 void __attribute__((deprecated("Use rcc_clock_setup_pll as direct replacement"))) rcc_clock_setup_hse_3v3(const struct rcc_clock_scale *clock);
 uint32_t rcc_get_usart_clk_freq(uint32_t usart);
 uint32_t rcc_get_timer_clk_freq(uint32_t timer);
@@ -38,4 +38,9 @@
 
 #include <libopencm3/stm32/common/syscfg_common_l1f234.h>
 
+/* --- SYSCFG_MEMRM Values ------------------------------------------------- */
+
+/* Bank 2 mapped at 0x08000000, dual bank parts only */
+#define SYSCFG_MEMRM_UFB_MODE		(1 << 8)
+
 #endif
@@ -411,8 +411,6 @@
 #define FDCAN_RXF1A_R1AI_SHIFT			FDCAN_RXFIFO_AI_SHIFT
 #define FDCAN_RXF1A_R1AI_MASK			FDCAN_RXFIFO_AI_MASK
 
-#define FDCAN_TXBC_TFQM					(1 << 24)
-
 /** TFFL[2:0]: Tx FIFO free level */
 #define FDCAN_TXFQS_TFFL_SHIFT			0
 
@@ -724,6 +722,74 @@ struct fdcan_tx_buffer_element {
 #define FDCAN_FIFO_RXTS_SHIFT			0
 #define FDCAN_FIFO_RXTS_MASK			0xFFFF
 
+/** Structure describing a frame for batched transmission and reception.
+ * Used by @ref fdcan_transmit_batch and @ref fdcan_receive_batch. Payload
+ * is stored in ordinary RAM, so this structure may be accessed freely.
+ */
+struct fdcan_frame {
+	/** Message ID */
+	uint32_t id;
+	/** Message ID is extended */
+	bool ext;
+	/** Remote transmission request */
+	bool rtr;
+	/** Frame uses FDCAN format */
+	bool fdf;
+	/** Bitrate is switched for data portion of frame */
+	bool brs;
+	/** ID of filter which matched the frame. Received frames only. */
+	uint8_t fmi;
+	/** Payload length in bytes. Must be valid CAN or FDCAN frame length */
+	uint8_t length;
+	/** Timestamp of received frame. Received frames only. */
+	uint16_t timestamp;
+	/** Payload data */
+	uint8_t data[64];
+};
+
+/** Structure describing range of identifiers accepted by filters.
+ * Used by @ref fdcan_filter_plan.
+ */
+struct fdcan_filter_range {
+	/** First accepted ID */
+	uint32_t first;
+	/** Last accepted ID, inclusive. Equal to first for single ID. */
+	uint32_t last;
+	/** IDs are extended */
+	bool ext;
+};
+
+/** Structure describing partitioning of message RAM of one FDCAN block.
+ * Used by @ref fdcan_set_ram_layout. Element counts and sizes not supported
+ * by the device are rejected.
+ */
+struct fdcan_ram_layout {
+	/** Amount of standard ID filter rules */
+	uint8_t std_filters;
+	/** Amount of extended ID filter rules */
+	uint8_t ext_filters;
+	/** Amount of elements in receive FIFO 0 */
+	uint8_t rx_fifo0;
+	/** Amount of elements in receive FIFO 1 */
+	uint8_t rx_fifo1;
+	/** Amount of dedicated receive buffers (STM32H7 only) */
+	uint8_t rx_buffers;
+	/** Amount of elements in transmit event FIFO */
+	uint8_t tx_events;
+	/** Amount of dedicated transmit buffers (STM32H7 only) */
+	uint8_t tx_buffers;
+	/** Amount of elements in transmit FIFO/queue */
+	uint8_t tx_fifo;
+	/** Maximum payload size of receive FIFO 0 elements (STM32H7 only) */
+	uint8_t rx_fifo0_data;
+	/** Maximum payload size of receive FIFO 1 elements (STM32H7 only) */
+	uint8_t rx_fifo1_data;
+	/** Maximum payload size of dedicated receive buffers (STM32H7 only) */
+	uint8_t rx_buffer_data;
+	/** Maximum payload size of transmit buffers (STM32H7 only) */
+	uint8_t tx_data;
+};
+
 
 /** @defgroup fdcan_error FDCAN error return values
  * @{
@@ -780,6 +846,10 @@ void fdcan_set_ext_filter(uint32_t canport, uint32_t nr,
 		uint8_t id_list_mode, uint32_t id1, uint32_t id2,
 		uint8_t action);
 
+int fdcan_filter_plan(uint32_t canport, unsigned std_filters, unsigned ext_filters,
+		const struct fdcan_filter_range *ranges, unsigned count, uint8_t fifo,
+		bool *widened);
+
 void fdcan_enable_irq(uint32_t canport, uint32_t irq);
 void fdcan_disable_irq(uint32_t canport, uint32_t irq);
 
@@ -792,6 +862,15 @@ int fdcan_receive(uint32_t canport, uint8_t fifo, bool release, uint32_t *id,
 
 void fdcan_release_fifo(uint32_t canport, uint8_t fifo);
 
+int fdcan_transmit_batch(uint32_t canport, const struct fdcan_frame *frames,
+		unsigned count);
+
+int fdcan_receive_batch(uint32_t canport, uint8_t fifo, struct fdcan_frame *frames,
+		unsigned max);
+
+int fdcan_set_ram_layout(uint32_t canport, uint32_t offset,
+		const struct fdcan_ram_layout *layout);
+
 bool fdcan_available_tx(uint32_t canport);
 bool fdcan_available_rx(uint32_t canport, uint8_t fifo);
 
@@ -802,6 +881,7 @@ struct fdcan_extended_filter *fdcan_get_flesa_addr(uint32_t canport);
 struct fdcan_rx_fifo_element *fdcan_get_rxfifo_addr(uint32_t canport,
 		unsigned fifo_id, unsigned element_id);
 unsigned fdcan_get_fifo_element_size(uint32_t canport, unsigned fifo_id);
+unsigned fdcan_get_fifo_depth(uint32_t canport, unsigned fifo_id);
 
 struct fdcan_tx_event_element *fdcan_get_txevt_addr(uint32_t canport);
 struct fdcan_tx_buffer_element *fdcan_get_txbuf_addr(uint32_t canport, unsigned element_id);
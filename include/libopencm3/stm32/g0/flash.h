@@ -147,6 +147,8 @@
 #define FLASH_CR_EOPIE			(1 << 24)
 /** FLASH_CR_FSTPG Fast programming **/
 #define FLASH_CR_FSTPG			(1 << 18)
+/** FLASH_ROW_SIZE Fast programming row, 32 double words **/
+#define FLASH_ROW_SIZE			256
 /** FLASH_CR_OPTSTRT Options modification start **/
 #define FLASH_CR_OPTSTRT		(1 << 17)
 /** FLASH_CR_STRT Start **/
@@ -271,6 +273,7 @@ void flash_clear_status_flags(void);
 void flash_wait_for_last_operation(void);
 
 void flash_program_double_word(uint32_t address, uint64_t data);
+bool flash_program_row(uint32_t address, const uint8_t *data);
 void flash_program(uint32_t address, uint8_t *data, uint32_t len);
 
 void flash_erase_page(uint32_t page);
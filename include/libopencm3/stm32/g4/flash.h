@@ -46,6 +46,7 @@
 #include <libopencm3/stm32/common/flash_common_all.h>
 #include <libopencm3/stm32/common/flash_common_f.h>
 #include <libopencm3/stm32/common/flash_common_idcache.h>
+#include <libopencm3/stm32/common/flash_common_dualbank.h>
 
 /* --- FLASH registers ----------------------------------------------------- */
 
@@ -115,6 +116,9 @@
 #define FLASH_CR_PNB_SHIFT		3
 #define FLASH_CR_PNB_MASK		0x7f
 
+/* Start of bank 2 in dual bank mode, whatever the flash size */
+#define FLASH_BANK2_BASE		(FLASH_BASE + 0x40000)
+
 /* --- FLASH_ECCR values -------------------------------------------------- */
 
 #define FLASH_ECCR_ECCD			(1 << 31)
@@ -143,6 +147,7 @@
 #define FLASH_OPTR_SRAM_RST		(1 << 25)
 #define FLASH_OPTR_SRAM_PE		(1 << 24)
 #define FLASH_OPTR_nBOOT1		(1 << 23)
+#define FLASH_OPTR_DBANK		(1 << 22)
 #define FLASH_OPTR_DUALBANK		(1 << 21)
 #define FLASH_OPTR_BFB2			(1 << 20)
 #define FLASH_OPTR_WWDG_SW		(1 << 19)
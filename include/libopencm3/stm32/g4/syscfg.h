@@ -0,0 +1,59 @@
+/** @defgroup syscfg_defines SYSCFG Defines
+ *
+ * @ingroup STM32G4xx_defines
+ *
+ * @brief Defined Constants and Types for the STM32G4xx Sysconfig
+ *
+ * LGPL License Terms @ref lgpl_license
+ */
+
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBOPENCM3_SYSCFG_H
+#define LIBOPENCM3_SYSCFG_H
+/**@{*/
+
+/* --- SYSCFG registers ---------------------------------------------------- */
+
+#define SYSCFG_MEMRMP			MMIO32(SYSCFG_BASE + 0x00)
+#define SYSCFG_CFGR1			MMIO32(SYSCFG_BASE + 0x04)
+#define SYSCFG_EXTICR(i)		MMIO32(SYSCFG_BASE + 0x08 + (i)*4)
+#define SYSCFG_EXTICR1			SYSCFG_EXTICR(0)
+#define SYSCFG_EXTICR2			SYSCFG_EXTICR(1)
+#define SYSCFG_EXTICR3			SYSCFG_EXTICR(2)
+#define SYSCFG_EXTICR4			SYSCFG_EXTICR(3)
+#define SYSCFG_SCSR			MMIO32(SYSCFG_BASE + 0x18)
+#define SYSCFG_CFGR2			MMIO32(SYSCFG_BASE + 0x1C)
+#define SYSCFG_SWPR			MMIO32(SYSCFG_BASE + 0x20)
+#define SYSCFG_SKR			MMIO32(SYSCFG_BASE + 0x24)
+
+/* --- SYSCFG_MEMRMP Values ------------------------------------------------ */
+
+/* Bank 2 mapped at 0x08000000 */
+#define SYSCFG_MEMRMP_FB_MODE		(1 << 8)
+
+#define SYSCFG_MEMRMP_MEM_MODE_MASK	7
+#define SYSCFG_MEMRMP_MEM_MODE_FLASH	0
+#define SYSCFG_MEMRMP_MEM_MODE_SYSTEM	1
+#define SYSCFG_MEMRMP_MEM_MODE_FMC	2
+#define SYSCFG_MEMRMP_MEM_MODE_SRAM	3
+#define SYSCFG_MEMRMP_MEM_MODE_QSPI	4
+
+/**@}*/
+
+#endif
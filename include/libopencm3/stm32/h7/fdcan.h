@@ -135,10 +135,16 @@ LGPL License Terms @ref lgpl_license
 #define FDCAN_XIDFC_FLESA_MASK			FDCAN_FXSA_MASK
 #define FDCAN_XIDFC_FLESA_SHIFT			FDCAN_FXSA_SHIFT
 
+#define FDCAN_TXBC_TFQM					(1 << 30)
+
 /** TFQS[5:0]: Tx FIFO/Queue size */
 #define FDCAN_TXBC_TFQS_MASK			0x3F
 #define FDCAN_TXBC_TFQS_SHIFT			24
 
+/** NDTB[5:0]: Number of dedicated transmit buffers */
+#define FDCAN_TXBC_NDTB_MASK			0x3F
+#define FDCAN_TXBC_NDTB_SHIFT			16
+
 /** TBSA[7:0]: Transmit buffer start address */
 #define FDCAN_TXBC_TBSA_MASK			FDCAN_FXSA_MASK
 #define FDCAN_TXBC_TBSA_SHIFT			FDCAN_FXSA_SHIFT
@@ -190,6 +196,10 @@ LGPL License Terms @ref lgpl_license
 #define FDCAN_RXF1C_F1SA_MASK			FDCAN_RXFIC_FISA_MASK
 #define FDCAN_RXF1C_F1SA_SHIFT			FDCAN_RXFIC_FISA_SHIFT
 
+/** RBSA[13:0]: Rx buffer start address */
+#define FDCAN_RXBC_RBSA_MASK			FDCAN_FXSA_MASK
+#define FDCAN_RXBC_RBSA_SHIFT			FDCAN_FXSA_SHIFT
+
 /** RBDS[3:0]: RX buffer data field size */
 #define FDCAN_RXESC_RBDS_MASK			0x7
 #define FDCAN_RXESC_RBDS_SHIFT			8
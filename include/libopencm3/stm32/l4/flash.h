@@ -44,6 +44,7 @@
 #include <libopencm3/stm32/common/flash_common_all.h>
 #include <libopencm3/stm32/common/flash_common_f.h>
 #include <libopencm3/stm32/common/flash_common_idcache.h>
+#include <libopencm3/stm32/common/flash_common_dualbank.h>
 
 /* --- FLASH registers ----------------------------------------------------- */
 
@@ -114,6 +115,9 @@
 #define FLASH_CR_PNB_SHIFT		3
 #define FLASH_CR_PNB_MASK		0xff
 
+/* Fast programming row, 32 double words */
+#define FLASH_ROW_SIZE			256
+
 /* --- FLASH_ECCR values -------------------------------------------------- */
 
 #define FLASH_ECCR_ECCD			(1 << 31)
@@ -130,6 +134,7 @@
 #define FLASH_OPTR_SRAM2_RST		(1 << 25)
 #define FLASH_OPTR_SRAM2_PE		(1 << 24)
 #define FLASH_OPTR_nBOOT1		(1 << 23)
+#define FLASH_OPTR_DBANK		(1 << 22)
 #define FLASH_OPTR_DUALBANK		(1 << 21)
 #define FLASH_OPTR_BFB2			(1 << 20)
 #define FLASH_OPTR_WWDG_SW		(1 << 19)
@@ -229,6 +234,7 @@ void flash_clear_pgaerr_flag(void);
 void flash_clear_wrperr_flag(void);
 void flash_lock_option_bytes(void);
 void flash_program_double_word(uint32_t address, uint64_t data);
+bool flash_program_row(uint32_t address, const uint8_t *data);
 void flash_program(uint32_t address, uint8_t *data, uint32_t len);
 void flash_erase_page(uint32_t page);
 void flash_erase_all_pages(void);
@@ -51,6 +51,9 @@
 
 /* --- SYSCFG_MEMRMP Values ------------------------------------------------ */
 
+/* Bank 2 mapped at 0x08000000 */
+#define SYSCFG_MEMRMP_FB_MODE		(1 << 8)
+
 #define SYSCFG_MEMRMP_MEM_MODE_MASK	7
 #define SYSCFG_MEMRMP_MEM_MODE_FLASH	0
 #define SYSCFG_MEMRMP_MEM_MODE_SYSTEM	1
@@ -36,6 +36,8 @@
 #       include <libopencm3/stm32/l1/syscfg.h>
 #elif defined(STM32L4)
 #       include <libopencm3/stm32/l4/syscfg.h>
+#elif defined(STM32G4)
+#       include <libopencm3/stm32/g4/syscfg.h>
 #elif defined(STM32G0)
 #       include <libopencm3/stm32/g0/syscfg.h>
 #elif defined(STM32H7)
@@ -0,0 +1,180 @@
+/** @defgroup CM3_mpu_file MPU
+ *
+ * @ingroup CM3_files
+ *
+ * @brief <b>libopencm3 Cortex-M Memory Protection Unit</b>
+ *
+ * The MPU assigns access permissions and memory attributes to up to 8 or 16
+ * regions. Each region is a power of two in size, at least 32 bytes, aligned
+ * to its size, and regions of 256 bytes and more are split into eight
+ * subregions that can be disabled individually. Where regions overlap, the
+ * one with the higher number wins.
+ *
+ * Besides protection, the attributes decide how the Cortex-M7 caches treat a
+ * region: DMA buffers in a non cacheable region need no cache maintenance.
+ *
+ * Example, with the pool bounds provided by the linker script:
+ * @code
+ *	extern uint8_t _dma_pool_start, _dma_pool_end;
+ *	struct mpu_region r;
+ *
+ *	if (mpu_region_for_range(&r, (uint32_t)&_dma_pool_start,
+ *				 (uint32_t)&_dma_pool_end)) {
+ *		mpu_set_region(0, &r, MPU_REGION_DMA_POOL);
+ *	}
+ *	mpu_enable(MPU_CTRL_PRIVDEFENA);
+ * @endcode
+ *
+ * @see ARMv7m Architecture Reference Manual (Chapter B3.5 Protected Memory
+ * System Architecture)
+ *
+ * LGPL License Terms @ref lgpl_license
+ * @{
+ */
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/cm3/mpu.h>
+
+/* Make new MPU settings apply to the following accesses and fetches. */
+static inline void mpu_sync(void)
+{
+	__asm__ volatile ("dsb\n\tisb" : : : "memory");
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief MPU Get the number of regions
+ *
+ * @return number of data regions, 0 if the MPU isn't implemented
+ */
+uint8_t mpu_get_region_count(void)
+{
+	return (MPU_TYPE & MPU_TYPE_DREGION) >> MPU_TYPE_DREGION_LSB;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief MPU Enable
+ *
+ * @param[in] ctrl any of MPU_CTRL_PRIVDEFENA, MPU_CTRL_HFNMIENA
+ */
+void mpu_enable(uint32_t ctrl)
+{
+	__asm__ volatile ("dmb" : : : "memory");
+	MPU_CTRL = (ctrl & (MPU_CTRL_PRIVDEFENA | MPU_CTRL_HFNMIENA)) |
+		   MPU_CTRL_ENABLE;
+	mpu_sync();
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief MPU Disable
+ */
+void mpu_disable(void)
+{
+	__asm__ volatile ("dmb" : : : "memory");
+	MPU_CTRL = 0;
+	mpu_sync();
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief MPU Find the region geometry covering an address range
+ *
+ * Finds the smallest region, with subregions disabled as needed, covering
+ * exactly start to end. Ranges from linker symbols are typically aligned in
+ * the linker script: a range is representable if its bounds are multiples of
+ * an eighth of the enclosing power of two.
+ *
+ * @param[out] region geometry for mpu_set_region()
+ * @param[in] start first address of the range
+ * @param[in] end address past the last byte of the range
+ * @return false if the range is empty or can't be covered exactly
+ */
+bool mpu_region_for_range(struct mpu_region *region, uint32_t start,
+			  uint32_t end)
+{
+	uint8_t size_log2;
+
+	if (end <= start) {
+		return false;
+	}
+
+	for (size_log2 = 5; size_log2 < 32; size_log2++) {
+		uint32_t size = 1UL << size_log2;
+		uint32_t base = start & ~(size - 1);
+		uint32_t sub = size / 8;
+		uint8_t first, last;
+
+		if (end - base > size) {
+			continue;
+		}
+		if (size < 256) {
+			/* No subregions below 256 bytes. */
+			if (start != base || end != base + size) {
+				continue;
+			}
+			first = 0;
+			last = 7;
+		} else {
+			if ((start - base) % sub || (end - base) % sub) {
+				continue;
+			}
+			first = (start - base) / sub;
+			last = (end - base) / sub - 1;
+		}
+
+		region->base = base;
+		region->size_log2 = size_log2;
+		/* Disable the subregions before first and after last. */
+		region->srd = (uint8_t)~((0xff << first) & (0xff >> (7 - last)));
+		return true;
+	}
+	return false;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief MPU Set up and enable a region
+ *
+ * @param[in] number region number, below mpu_get_region_count()
+ * @param[in] region geometry, see mpu_region_for_range()
+ * @param[in] attr region attributes, a @ref CM3_mpu_presets value or
+ * @ref CM3_mpu_memtype and @ref mpu_rasr_attributes combined
+ */
+void mpu_set_region(uint8_t number, const struct mpu_region *region,
+		    uint32_t attr)
+{
+	MPU_RNR = number;
+	MPU_RASR = 0;
+	MPU_RBAR = region->base & MPU_RBAR_ADDR;
+	MPU_RASR = (attr & ~(MPU_RASR_SRD | MPU_RASR_SIZE | MPU_RASR_ENABLE)) |
+		   ((uint32_t)region->srd << MPU_RASR_SRD_LSB) |
+		   ((uint32_t)(region->size_log2 - 1) << MPU_RASR_SIZE_LSB) |
+		   MPU_RASR_ENABLE;
+	mpu_sync();
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief MPU Disable a region
+ *
+ * @param[in] number region number, below mpu_get_region_count()
+ */
+void mpu_clear_region(uint8_t number)
+{
+	MPU_RNR = number;
+	MPU_RASR = 0;
+	mpu_sync();
+}
+
+/**@}*/
@@ -12,6 +12,7 @@
  * * fault information
  * * power management
  * * debug status information
+ * * cache maintenance (Cortex-M7)
  *
  * @see ARMv7m Architecture Reference Manual (Chapter B3.2.1 About the SCB)
  *
@@ -66,4 +67,264 @@ void scb_set_priority_grouping(uint32_t prigroup)
 }
 #endif
 
+/* Cache maintenance, only present on Cortex-M7 */
+#if defined(__ARM_ARCH_7EM__)
+static inline void scb_dsb(void)
+{
+	__asm__ volatile ("dsb" : : : "memory");
+}
+
+static inline void scb_isb(void)
+{
+	__asm__ volatile ("isb" : : : "memory");
+}
+
+/* Apply a set/way operation to every line of the L1 data cache. Always
+ * inlined, the loop must not touch the stack, see scb_disable_dcache(). */
+static inline __attribute__((always_inline))
+void scb_dcache_set_way(volatile uint32_t *reg)
+{
+	uint32_t ccsidr, sets, ways, set_shift, way_shift, set, way;
+
+	SCB_CCSELR = 0;
+	scb_dsb();
+	ccsidr = SCB_CCSIDR;
+
+	sets = (ccsidr >> SCB_CCSIDR_NUMSETS_SHIFT) & SCB_CCSIDR_NUMSETS_MASK;
+	ways = (ccsidr >> SCB_CCSIDR_ASSOCIATIVITY_SHIFT) &
+	       SCB_CCSIDR_ASSOCIATIVITY_MASK;
+	set_shift = ((ccsidr >> SCB_CCSIDR_LINESIZE_SHIFT) &
+		     SCB_CCSIDR_LINESIZE_MASK) + 4;
+	way_shift = ways ? __builtin_clz(ways) : 0;
+
+	for (set = 0; set <= sets; set++) {
+		for (way = 0; way <= ways; way++) {
+			*reg = (way << way_shift) | (set << set_shift);
+		}
+	}
+	scb_dsb();
+}
+
+/* Apply a by address operation to all lines covering addr..addr+len. */
+static void scb_dcache_range(volatile uint32_t *reg, uint32_t addr,
+			     size_t len)
+{
+	uint32_t line = 4 << ((SCB_CTR >> SCB_CTR_DMINLINE_SHIFT) &
+			      SCB_CTR_DMINLINE_MASK);
+	uint32_t end = addr + len;
+
+	scb_dsb();
+	for (addr &= ~(line - 1); addr < end; addr += line) {
+		*reg = addr;
+	}
+	scb_dsb();
+}
+
+/** Invalidate and enable the instruction cache */
+void scb_enable_icache(void)
+{
+	if (SCB_CCR & SCB_CCR_IC) {
+		return;
+	}
+	scb_dsb();
+	scb_isb();
+	SCB_ICIALLU = 0;
+	scb_dsb();
+	scb_isb();
+	SCB_CCR |= SCB_CCR_IC;
+	scb_dsb();
+	scb_isb();
+}
+
+/** Disable and invalidate the instruction cache */
+void scb_disable_icache(void)
+{
+	scb_dsb();
+	scb_isb();
+	SCB_CCR &= ~SCB_CCR_IC;
+	SCB_ICIALLU = 0;
+	scb_dsb();
+	scb_isb();
+}
+
+/** Invalidate the instruction cache, after code in RAM or flash changed */
+void scb_invalidate_icache(void)
+{
+	scb_dsb();
+	scb_isb();
+	SCB_ICIALLU = 0;
+	scb_dsb();
+	scb_isb();
+}
+
+/** Invalidate the instruction cache lines covering a range
+ * @param[in] addr start address
+ * @param[in] len length in bytes
+ */
+void scb_invalidate_icache_range(const void *addr, size_t len)
+{
+	uint32_t line = 4 << ((SCB_CTR >> SCB_CTR_IMINLINE_SHIFT) &
+			      SCB_CTR_IMINLINE_MASK);
+	uint32_t a = (uint32_t)addr & ~(line - 1);
+	uint32_t end = (uint32_t)addr + len;
+
+	scb_dsb();
+	for (; a < end; a += line) {
+		SCB_ICIMVAU = a;
+	}
+	scb_dsb();
+	scb_isb();
+}
+
+/** Invalidate and enable the data cache */
+void scb_enable_dcache(void)
+{
+	if (SCB_CCR & SCB_CCR_DC) {
+		return;
+	}
+	scb_dcache_set_way(&SCB_DCISW);
+	SCB_CCR |= SCB_CCR_DC;
+	scb_dsb();
+	scb_isb();
+}
+
+/** Disable the data cache, writing back dirty lines */
+void scb_disable_dcache(void)
+{
+	/* Once DC is clear, stores bypass the cache and the clean below writes
+	 * older dirty lines over them. Nothing may be stored until it is done,
+	 * so the set/way loop runs inline, in registers. */
+	SCB_CCR &= ~SCB_CCR_DC;
+	scb_dsb();
+	scb_dcache_set_way(&SCB_DCCISW);
+	scb_isb();
+}
+
+/** Write back all dirty data cache lines */
+void scb_clean_dcache(void)
+{
+	scb_dcache_set_way(&SCB_DCCSW);
+}
+
+/** Discard the whole data cache, dirty lines are lost */
+void scb_invalidate_dcache(void)
+{
+	scb_dcache_set_way(&SCB_DCISW);
+}
+
+/** Write back and discard the whole data cache */
+void scb_clean_invalidate_dcache(void)
+{
+	scb_dcache_set_way(&SCB_DCCISW);
+}
+
+/** Write back the data cache lines covering a range
+ * @param[in] addr start address
+ * @param[in] len length in bytes
+ */
+void scb_clean_dcache_range(const void *addr, size_t len)
+{
+	scb_dcache_range(&SCB_DCCMVAC, (uint32_t)addr, len);
+}
+
+/** Discard the data cache lines covering a range
+ *
+ * Lines only partly covered by the range are written back first so that
+ * neighbouring data isn't lost, keep buffers cache line aligned.
+ * @param[in] addr start address
+ * @param[in] len length in bytes
+ */
+void scb_invalidate_dcache_range(void *addr, size_t len)
+{
+	uint32_t line = 4 << ((SCB_CTR >> SCB_CTR_DMINLINE_SHIFT) &
+			      SCB_CTR_DMINLINE_MASK);
+	uint32_t start = (uint32_t)addr;
+	uint32_t end = start + len;
+
+	if (!len) {
+		return;
+	}
+	if (start & (line - 1)) {
+		scb_dcache_range(&SCB_DCCIMVAC, start, 1);
+		start = (start | (line - 1)) + 1;
+	}
+	if ((end & (line - 1)) && end > start) {
+		scb_dcache_range(&SCB_DCCIMVAC, end - 1, 1);
+		end &= ~(line - 1);
+	}
+	if (end > start) {
+		scb_dcache_range(&SCB_DCIMVAC, start, end - start);
+	}
+}
+
+/** Write back and discard the data cache lines covering a range
+ * @param[in] addr start address
+ * @param[in] len length in bytes
+ */
+void scb_clean_invalidate_dcache_range(void *addr, size_t len)
+{
+	scb_dcache_range(&SCB_DCCIMVAC, (uint32_t)addr, len);
+}
+
+/** Make a buffer visible to a DMA reading it
+ *
+ * Call after filling the buffer and before starting the DMA. Does nothing
+ * while the data cache is disabled.
+ * @param[in] buf buffer
+ * @param[in] len length in bytes
+ */
+void scb_prepare_dma_tx(const void *buf, size_t len)
+{
+	if (SCB_CCR & SCB_CCR_DC) {
+		scb_clean_dcache_range(buf, len);
+	}
+}
+
+/** Prepare a buffer for a DMA writing it
+ *
+ * Call before starting the DMA, so no dirty line is evicted over the
+ * received data. Does nothing while the data cache is disabled.
+ * @param[in] buf buffer, preferably cache line aligned
+ * @param[in] len length in bytes
+ */
+void scb_prepare_dma_rx(void *buf, size_t len)
+{
+	if (SCB_CCR & SCB_CCR_DC) {
+		scb_clean_invalidate_dcache_range(buf, len);
+	}
+}
+
+/** Make data written by a DMA visible to the CPU
+ *
+ * Call once the DMA completed, before reading the buffer. Does nothing while
+ * the data cache is disabled.
+ * @param[in] buf buffer, preferably cache line aligned
+ * @param[in] len length in bytes
+ */
+void scb_complete_dma_rx(void *buf, size_t len)
+{
+	if (SCB_CCR & SCB_CCR_DC) {
+		scb_invalidate_dcache_range(buf, len);
+	}
+}
+#else
+void scb_prepare_dma_tx(const void *buf, size_t len)
+{
+	(void)buf;
+	(void)len;
+}
+
+void scb_prepare_dma_rx(void *buf, size_t len)
+{
+	(void)buf;
+	(void)len;
+}
+
+void scb_complete_dma_rx(void *buf, size_t len)
+{
+	(void)buf;
+	(void)len;
+}
+#endif
+
 /**@}*/
\ No newline at end of file
@@ -2,14 +2,238 @@
  * @ingroup peripheral_apis
  * @brief Memory Systems Controller helper functions.
  *
- * <b>NO</b> helper functions exist. Only header definitions are available.
- * Delete these lines if/when you add actual helper APIs.
+ * Flash erase and programming. Blocks of words are written in "write
+ * ongoing" mode (WRITETRIG): the next word is loaded into the WDATA buffer
+ * while the previous one is programmed, so consecutive words of a page are
+ * written without the per word setup of msc_program_word(). The next word must
+ * arrive within the MSC timeout, so msc_program() disables interrupts while a
+ * page is written, msc_program_dma() lets the DMA controller feed WDATA with
+ * interrupts enabled.
+ *
+ * Example:
+ * @code
+ *	msc_unlock();
+ *	msc_erase_page(0x00020000);
+ *	msc_program(0x00020000, image, sizeof(image) / 4);
+ *	msc_lock();
+ * @endcode
+ *
  * @copyright See @ref lgpl_license
  */
 
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/efm32/msc.h>
 
 /**@{*/
 
-/**@}*/
+static MSC_RAMFUNC void msc_wait_for_last_operation(void)
+{
+	while (MSC_STATUS & MSC_STATUS_BUSY);
+}
+
+static MSC_RAMFUNC bool msc_load_address(uint32_t address)
+{
+	MSC_ADDRB = address;
+	MSC_WRITECMD = MSC_WRITECMD_LADDRIM;
+	return !(MSC_STATUS & (MSC_STATUS_INVADDR | MSC_STATUS_LOCKED));
+}
+
+/* Number of words from address to the end of its page, at most count */
+static MSC_RAMFUNC uint32_t msc_page_words(uint32_t address, uint32_t count)
+{
+	uint32_t n = (MSC_PAGE_SIZE - (address % MSC_PAGE_SIZE)) / 4;
+
+	return (count < n) ? count : n;
+}
+
+/**
+ * Unlock the MSC registers and enable flash erase and write.
+ */
+void msc_unlock(void)
+{
+	MSC_LOCK = MSC_LOCK_LOCKKEY_UNLOCK;
+	MSC_WRITECTRL |= MSC_WRITECTRL_WREN;
+}
+
+/**
+ * Disable flash erase and write and lock the MSC registers.
+ */
+void msc_lock(void)
+{
+	MSC_WRITECTRL &= ~MSC_WRITECTRL_WREN;
+	MSC_LOCK = MSC_LOCK_LOCKKEY_LOCK;
+}
+
+/**
+ * Erase a flash page
+ * @param[in] address any address in the page
+ * @retval true on success
+ * @retval false if the address is invalid or the page is locked
+ */
+MSC_RAMFUNC bool msc_erase_page(uint32_t address)
+{
+	if (!msc_load_address(address)) {
+		return false;
+	}
+	MSC_WRITECMD = MSC_WRITECMD_ERASEPAGE;
+	msc_wait_for_last_operation();
+	return true;
+}
 
+/**
+ * Program a single word
+ * @param[in] address word aligned address
+ * @param[in] data word to write
+ * @retval true on success
+ * @retval false if the address is invalid or the page is locked
+ */
+MSC_RAMFUNC bool msc_program_word(uint32_t address, uint32_t data)
+{
+	if (!msc_load_address(address)) {
+		return false;
+	}
+	MSC_WDATA = data;
+	MSC_WRITECMD = MSC_WRITECMD_WRITEONCE;
+	msc_wait_for_last_operation();
+	return true;
+}
+
+/* Write count words, all in one page, in write ongoing mode. */
+static MSC_RAMFUNC bool msc_program_page(uint32_t address,
+					 const uint32_t *data, uint32_t count)
+{
+	bool ok = true;
+
+	if (!msc_load_address(address)) {
+		return false;
+	}
+
+	CM_ATOMIC_BLOCK() {
+		MSC_WDATA = *data++;
+		MSC_WRITECMD = MSC_WRITECMD_WRITETRIG;
+		while (--count) {
+			while (!(MSC_STATUS & MSC_STATUS_WDATAREADY));
+			/* The sequence ended, the word would be lost. */
+			if (!(MSC_STATUS & MSC_STATUS_BUSY)) {
+				ok = false;
+				break;
+			}
+			MSC_WDATA = *data++;
+		}
+		msc_wait_for_last_operation();
+	}
+	return ok;
+}
+
+/**
+ * Program a block of words
+ *
+ * Each page is written in write ongoing mode with interrupts disabled.
+ * @param[in] address word aligned start address
+ * @param[in] data words to write
+ * @param[in] count number of words
+ * @retval true on success
+ * @retval false if an address is invalid, a page is locked or the write
+ * sequence timed out
+ */
+MSC_RAMFUNC bool msc_program(uint32_t address, const uint32_t *data,
+			     uint32_t count)
+{
+	while (count) {
+		uint32_t n = msc_page_words(address, count);
+
+		if (!msc_program_page(address, data, n)) {
+			return false;
+		}
+		address += n * 4;
+		data += n;
+		count -= n;
+	}
+	return true;
+}
+
+/**
+ * Program a block of words with the DMA controller feeding WDATA
+ *
+ * The DMA controller must be enabled and its descriptors set with
+ * dma_set_desc_address(). The channel's done flag is polled, so its interrupt
+ * should be disabled. Interrupts stay enabled.
+ * @param[in] desc_base channel descriptor table
+ * @param[in] ch DMA channel (use DMA_CHx)
+ * @param[in] address word aligned start address
+ * @param[in] data words to write
+ * @param[in] count number of words
+ * @retval true on success
+ * @retval false if an address is invalid, a page is locked or the write
+ * sequence timed out
+ */
+bool msc_program_dma(uint32_t desc_base, enum dma_ch ch, uint32_t address,
+		     const uint32_t *data, uint32_t count)
+{
+	while (count) {
+		uint32_t n = msc_page_words(address, count);
+
+		if (!msc_load_address(address)) {
+			return false;
+		}
+
+		/* The CPU writes the first word, the DMA the rest. */
+		if (n > 1) {
+			dma_channel_reset(ch);
+			dma_set_source(ch, DMA_CH_CTRL_SOURCESEL(
+					   DMA_CH_CTRL_SOURCESEL_MSC));
+			dma_set_signal(ch, DMA_CH_CTRL_SIGSEL(
+					   DMA_CH_CTRL_SIGSEL_MSCWDATA));
+			DMA_DESC_CHx_CFG(desc_base, ch) = 0;
+			dma_desc_set_dest_size(desc_base, ch, DMA_MEM_WORD);
+			dma_desc_set_dest_inc(desc_base, ch, DMA_MEM_NONE);
+			dma_desc_set_src_size(desc_base, ch, DMA_MEM_WORD);
+			dma_desc_set_src_inc(desc_base, ch, DMA_MEM_WORD);
+			dma_desc_set_r_power(desc_base, ch, DMA_R_POWER_1);
+			dma_desc_set_count(desc_base, ch, n - 1);
+			dma_desc_set_src_address(desc_base, ch,
+						 (uint32_t)(data + 1));
+			dma_desc_set_dest_address(desc_base, ch,
+						  (uint32_t)&MSC_WDATA);
+			dma_desc_set_mode(desc_base, ch, DMA_MODE_BASIC);
+			dma_enable_periph_request(ch);
+		}
+
+		MSC_WDATA = data[0];
+		MSC_WRITECMD = MSC_WRITECMD_WRITETRIG;
+		if (n > 1) {
+			dma_enable_channel(ch);
+			while (!dma_get_done_interrupt_flag(ch));
+			dma_clear_done_interrupt_flag(ch);
+		}
+		msc_wait_for_last_operation();
+
+		/* The DMA missed the timeout, some words weren't written. */
+		if (MMIO32(address + (n - 1) * 4) != data[n - 1]) {
+			return false;
+		}
+		address += n * 4;
+		data += n;
+		count -= n;
+	}
+	return true;
+}
+
+/**@}*/
@@ -36,12 +36,16 @@
 #include <libopencm3/ethernet/phy.h>
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/scb.h>
 
 /**@{*/
 
 uint32_t TxBD;
 uint32_t RxBD;
 
+/* Cache maintenance covers the whole slot of a descriptor */
+#define ETH_DES_CACHE_SIZE	ETH_DESC_ROUND(ETH_DES_STD_SIZE)
+
 /*---------------------------------------------------------------------------*/
 /** @brief Set MAC to the PHY
  *
@@ -61,22 +65,29 @@ void eth_set_mac(const uint8_t *mac)
  * @param[in] buf uint8_t* Memory area for the descriptors and data buffers
  * @param[in] nTx uint32_t Count of transmit descriptors (equal to count of buffers)
  * @param[in] nRx uint32_t Count of receive descriptors (equal to count of buffers)
- * @param[in] cTx uint32_t Bytes in each transmit buffer, must be a
- *                         multiple of 4
- * @param[in] cRx uint32_t Bytes in each receive buffer, must be a
- *                         multiple of 4
+ * @param[in] cTx uint32_t Bytes in each transmit buffer, rounded up to a
+ *                         multiple of ETH_DESC_ALIGN
+ * @param[in] cRx uint32_t Bytes in each receive buffer, rounded up to a
+ *                         multiple of ETH_DESC_ALIGN
  * @param[in] isext bool true if extended descriptors should be used
  *
- * Note, the space passed via buf pointer must be large enough to
- * hold all the buffers and one descriptor per buffer.
+ * Note, the space passed via buf pointer must hold ETH_DESC_MEM_SIZE() bytes
+ * and be aligned to ETH_DESC_ALIGN. On STM32F7 that is the 32 byte data cache
+ * line: descriptors and buffers are padded to whole lines, so cleaning a
+ * descriptor can't write stale cache contents over a received frame.
  */
 void eth_desc_init(uint8_t *buf, uint32_t nTx, uint32_t nRx, uint32_t cTx,
 		    uint32_t cRx, bool isext)
 {
 	uint32_t bd = (uint32_t)buf;
-	uint32_t sz = isext ? ETH_DES_EXT_SIZE : ETH_DES_STD_SIZE;
+	uint32_t sz = ETH_DESC_ROUND(isext ? ETH_DES_EXT_SIZE :
+					   ETH_DES_STD_SIZE);
+	uint32_t size = ETH_DESC_MEM_SIZE(nTx, nRx, cTx, cRx, isext);
+
+	cTx = ETH_DESC_ROUND(cTx);
+	cRx = ETH_DESC_ROUND(cRx);
 
-	memset(buf, 0, nTx * (cTx + sz) + nRx * (cRx + sz));
+	memset(buf, 0, size);
 
 	/* enable / disable extended frames */
 	if (isext) {
@@ -112,6 +123,9 @@ void eth_desc_init(uint8_t *buf, uint32_t nTx, uint32_t nRx, uint32_t cTx,
 	ETH_DES2(bd) = bd + sz;
 	ETH_DES3(bd) = RxBD;
 
+	/* The DMA reads the descriptors from memory, not the data cache. */
+	scb_prepare_dma_tx(buf, size);
+
 	ETH_DMARDLAR = (uint32_t) RxBD;
 	ETH_DMATDLAR = (uint32_t) TxBD;
 }
@@ -125,14 +139,17 @@ void eth_desc_init(uint8_t *buf, uint32_t nTx, uint32_t nRx, uint32_t cTx,
  */
 bool eth_tx(uint8_t *ppkt, uint32_t n)
 {
+	scb_complete_dma_rx((void *)TxBD, ETH_DES_CACHE_SIZE);
 	if (ETH_DES0(TxBD) & ETH_TDES0_OWN) {
 		return false;
 	}
 
 	memcpy((void *)ETH_DES2(TxBD), ppkt, n);
+	scb_prepare_dma_tx((void *)ETH_DES2(TxBD), n);
 
 	ETH_DES1(TxBD) = n & ETH_TDES1_TBS1;
 	ETH_DES0(TxBD) |= ETH_TDES0_LS | ETH_TDES0_FS | ETH_TDES0_OWN;
+	scb_prepare_dma_tx((void *)TxBD, ETH_DES_CACHE_SIZE);
 	TxBD = ETH_DES3(TxBD);
 
 	if (ETH_DMASR & ETH_DMASR_TBUS) {
@@ -158,6 +175,7 @@ bool eth_rx(uint8_t *ppkt, uint32_t *len, uint32_t maxlen)
 	bool overrun = false;
 	uint32_t l = 0;
 
+	scb_complete_dma_rx((void *)RxBD, ETH_DES_CACHE_SIZE);
 	while (!(ETH_DES0(RxBD) & ETH_RDES0_OWN) && !ls) {
 		l = (ETH_DES0(RxBD) & ETH_RDES0_FL) >> ETH_RDES0_FL_SHIFT;
 
@@ -167,6 +185,7 @@ bool eth_rx(uint8_t *ppkt, uint32_t *len, uint32_t maxlen)
 		overrun |= fs && (maxlen < l);
 
 		if (fs && !overrun) {
+			scb_complete_dma_rx((void *)ETH_DES2(RxBD), l);
 			memcpy(ppkt, (void *)ETH_DES2(RxBD), l);
 			ppkt += l;
 			*len += l;
@@ -174,7 +193,9 @@ bool eth_rx(uint8_t *ppkt, uint32_t *len, uint32_t maxlen)
 		}
 
 		ETH_DES0(RxBD) = ETH_RDES0_OWN;
+		scb_prepare_dma_tx((void *)RxBD, ETH_DES_CACHE_SIZE);
 		RxBD = ETH_DES3(RxBD);
+		scb_complete_dma_rx((void *)RxBD, ETH_DES_CACHE_SIZE);
 	}
 
 	if (ETH_DMASR & ETH_DMASR_RBUS) {
@@ -280,7 +301,9 @@ void eth_enable_checksum_offload(void)
 {
 	uint32_t tab = TxBD;
 	do {
+		scb_complete_dma_rx((void *)tab, ETH_DES_CACHE_SIZE);
 		ETH_DES0(tab) |= ETH_TDES0_CIC_IPPLPH;
+		scb_prepare_dma_tx((void *)tab, ETH_DES_CACHE_SIZE);
 		tab = ETH_DES3(tab);
 	}
 	while (tab != TxBD);
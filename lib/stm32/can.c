@@ -35,6 +35,7 @@ LGPL License Terms @ref lgpl_license
  * along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/stm32/can.h>
 #include <libopencm3/stm32/rcc.h>
 
@@ -317,6 +318,310 @@ void can_filter_id_list_32bit_init(uint32_t nr,
 	can_filter_init(nr, true, true, id1, id2, fifo, enable);
 }
 
+/* --- Filter planner ------------------------------------------------------ */
+
+#define CAN_FILTER_STD_MASK	0x7FF
+#define CAN_FILTER_EXT_MASK	0x1FFFFFFF
+/* Marks an extended identifier in can_filter_entry::id */
+#define CAN_FILTER_EXT		(1 << 31)
+/* Enough for 28 banks of four 16 bit list entries */
+#define CAN_FILTER_PLAN_MAX	112
+
+struct can_filter_entry {
+	uint32_t id;
+	uint32_t mask;		/* identifier bits that must match */
+};
+
+struct can_filter_work {
+	struct can_filter_entry entry[CAN_FILTER_PLAN_MAX];
+	uint32_t count;
+	bool widened;
+};
+
+static uint32_t can_filter_full(uint32_t id)
+{
+	return (id & CAN_FILTER_EXT) ? CAN_FILTER_EXT_MASK : CAN_FILTER_STD_MASK;
+}
+
+/* Number of identifiers accepted with the given mask. */
+static uint32_t can_filter_span(uint32_t id, uint32_t mask)
+{
+	return 1 << __builtin_popcount(can_filter_full(id) & ~mask);
+}
+
+/* true if all identifiers of b are accepted by a */
+static bool can_filter_covers(const struct can_filter_entry *a,
+			      const struct can_filter_entry *b)
+{
+	return ((a->id ^ b->id) & CAN_FILTER_EXT) == 0 &&
+	       (b->mask & a->mask) == a->mask &&
+	       ((a->id ^ b->id) & a->mask) == 0;
+}
+
+static void can_filter_remove_covered(struct can_filter_work *work,
+				      uint32_t by)
+{
+	uint32_t i = 0;
+
+	while (i < work->count) {
+		if (i != by &&
+		    can_filter_covers(&work->entry[by], &work->entry[i])) {
+			work->entry[i] = work->entry[--work->count];
+			if (by == work->count) {
+				by = i;
+			}
+		} else {
+			i++;
+		}
+	}
+}
+
+/* Merge the pair of entries whose merge accepts the fewest identifiers that
+ * neither of them accepted. */
+static void can_filter_merge_best(struct can_filter_work *work)
+{
+	uint32_t best_i = 0, best_j = 0, best_extra = UINT32_MAX;
+	uint32_t i, j;
+
+	for (i = 0; i < work->count; i++) {
+		for (j = i + 1; j < work->count; j++) {
+			const struct can_filter_entry *a = &work->entry[i];
+			const struct can_filter_entry *b = &work->entry[j];
+			uint32_t mask, both, extra;
+
+			if ((a->id ^ b->id) & CAN_FILTER_EXT) {
+				continue;
+			}
+			mask = a->mask & b->mask & ~(a->id ^ b->id);
+			both = can_filter_span(a->id, a->mask) +
+			       can_filter_span(b->id, b->mask);
+			if (((a->id ^ b->id) & a->mask & b->mask) == 0) {
+				both -= can_filter_span(a->id,
+							a->mask | b->mask);
+			}
+			extra = can_filter_span(a->id, mask) - both;
+			if (extra < best_extra) {
+				best_extra = extra;
+				best_i = i;
+				best_j = j;
+			}
+		}
+	}
+
+	if (best_extra == UINT32_MAX) {
+		return;
+	}
+	if (best_extra) {
+		work->widened = true;
+	}
+	work->entry[best_i].mask &= work->entry[best_j].mask &
+		~(work->entry[best_i].id ^ work->entry[best_j].id);
+	work->entry[best_i].id &= work->entry[best_i].mask | CAN_FILTER_EXT;
+	can_filter_remove_covered(work, best_i);
+}
+
+static void can_filter_add(struct can_filter_work *work, uint32_t id,
+			   uint32_t mask)
+{
+	struct can_filter_entry e = { .id = id, .mask = mask };
+	uint32_t i;
+
+	for (i = 0; i < work->count; i++) {
+		if (can_filter_covers(&work->entry[i], &e)) {
+			return;
+		}
+	}
+	if (work->count == CAN_FILTER_PLAN_MAX) {
+		can_filter_merge_best(work);
+	}
+	work->entry[work->count++] = e;
+	can_filter_remove_covered(work, work->count - 1);
+}
+
+/* Banks needed for the current entries. Standard identifiers fit four to a
+ * 16 bit list bank, standard masks two to a 16 bit mask bank. Moving some of
+ * the identifiers to mask banks may fill up a half empty bank, *std_as_mask
+ * returns how many of them to move. Extended identifiers take 32 bit banks,
+ * two per list bank or one per mask bank. */
+static uint32_t can_filter_banks(const struct can_filter_work *work,
+				 uint32_t *std_as_mask)
+{
+	uint32_t std_id = 0, std_mask = 0, ext_id = 0, ext_mask = 0;
+	uint32_t i, k, banks, best = UINT32_MAX;
+
+	for (i = 0; i < work->count; i++) {
+		const struct can_filter_entry *e = &work->entry[i];
+		bool exact = e->mask == can_filter_full(e->id);
+
+		if ((e->id & CAN_FILTER_EXT) && exact) {
+			ext_id++;
+		} else if (e->id & CAN_FILTER_EXT) {
+			ext_mask++;
+		} else if (exact) {
+			std_id++;
+		} else {
+			std_mask++;
+		}
+	}
+
+	for (k = 0; k <= std_id; k++) {
+		banks = (std_id - k + 3) / 4 + (std_mask + k + 1) / 2;
+		if (banks < best) {
+			best = banks;
+			*std_as_mask = k;
+		}
+	}
+	return best + (ext_id + 1) / 2 + ext_mask;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief CAN Plan and program acceptance filters
+
+Compiles a list of identifiers and identifier ranges into as few filter banks
+as possible and programs them. Ranges are split into exact id/mask pairs,
+single standard identifiers are packed four to a 16 bit list bank, standard
+masks two to a 16 bit mask bank and extended identifiers into 32 bit banks.
+If the result does not fit into the given banks, the pairs of filters that
+add the fewest unwanted identifiers are merged into wider masks until it
+does. The filters accept data frames only. Unused banks of the given region
+are deactivated.
+
+The planner works on the stack and needs about 1kB of it.
+
+@param[in] first Unsigned int32. First filter bank to use.
+@param[in] banks Unsigned int32. Number of filter banks available.
+@param[in] ranges identifiers to accept
+@param[in] count Unsigned int32. Number of entries in ranges.
+@param[in] fifo Unsigned int32. FIFO id.
+@param[out] widened set to true if masks had to be widened, so that more
+identifiers than requested are accepted. May be NULL.
+@returns Number of banks used, -1 if a range is invalid or if standard and
+extended identifiers are requested but only one bank is available.
+ */
+int can_filter_plan(uint32_t first, uint32_t banks,
+		    const struct can_filter_range *ranges, uint32_t count,
+		    uint32_t fifo, bool *widened)
+{
+	struct can_filter_work work;
+	uint32_t std_ids[4], std_masks[4], ext[2];
+	uint32_t n_ids = 0, n_masks = 0, n_ext = 0;
+	uint32_t i, k, std_as_mask = 0;
+	uint32_t nr = first;
+	bool has_std = false, has_ext = false;
+
+	work.count = 0;
+	work.widened = false;
+
+	for (i = 0; i < count; i++) {
+		uint32_t full = ranges[i].ext ? CAN_FILTER_EXT_MASK :
+						CAN_FILTER_STD_MASK;
+		uint32_t flag = ranges[i].ext ? CAN_FILTER_EXT : 0;
+		uint32_t id = ranges[i].first;
+
+		if (id > ranges[i].last || ranges[i].last > full) {
+			return -1;
+		}
+		if (ranges[i].ext) {
+			has_ext = true;
+		} else {
+			has_std = true;
+		}
+
+		/* Largest aligned blocks covering the range exactly. */
+		while (id <= ranges[i].last) {
+			uint32_t size = 1;
+
+			while ((id & size) == 0 && (size << 1) <= full + 1 &&
+			       id + (size << 1) - 1 <= ranges[i].last) {
+				size <<= 1;
+			}
+			can_filter_add(&work, id | flag, full & ~(size - 1));
+			id += size;
+		}
+	}
+
+	if (banks < (has_std ? 1U : 0U) + (has_ext ? 1U : 0U)) {
+		return -1;
+	}
+	while (can_filter_banks(&work, &std_as_mask) > banks) {
+		can_filter_merge_best(&work);
+	}
+
+	for (i = 0, k = 0; i < work.count; i++) {
+		const struct can_filter_entry *e = &work.entry[i];
+		uint32_t id = e->id & ~CAN_FILTER_EXT;
+
+		if (e->id & CAN_FILTER_EXT) {
+			if (e->mask != CAN_FILTER_EXT_MASK) {
+				/* EXID at bit 3, IDE and RTR must match. */
+				can_filter_id_mask_32bit_init(nr++,
+					(id << 3) | CAN_TIxR_IDE,
+					(e->mask << 3) | CAN_TIxR_IDE |
+					CAN_TIxR_RTR, fifo, true);
+				continue;
+			}
+			ext[n_ext++] = (id << 3) | CAN_TIxR_IDE;
+			if (n_ext == 2) {
+				can_filter_id_list_32bit_init(nr++, ext[0],
+							      ext[1], fifo,
+							      true);
+				n_ext = 0;
+			}
+			continue;
+		}
+
+		/* 16 bit format: STID at bit 5, RTR at 4 and IDE at 3. */
+		if (e->mask == CAN_FILTER_STD_MASK && k++ >= std_as_mask) {
+			std_ids[n_ids++] = id << 5;
+			if (n_ids == 4) {
+				can_filter_id_list_16bit_init(nr++,
+					std_ids[0], std_ids[1],
+					std_ids[2], std_ids[3], fifo, true);
+				n_ids = 0;
+			}
+			continue;
+		}
+		std_masks[n_masks++] = id << 5;
+		std_masks[n_masks++] = (e->mask << 5) | (1 << 4) | (1 << 3);
+		if (n_masks == 4) {
+			can_filter_id_mask_16bit_init(nr++,
+				std_masks[0], std_masks[1],
+				std_masks[2], std_masks[3], fifo, true);
+			n_masks = 0;
+		}
+	}
+
+	/* Fill partial banks by repeating their last entry. */
+	if (n_ids) {
+		for (i = n_ids; i < 4; i++) {
+			std_ids[i] = std_ids[n_ids - 1];
+		}
+		can_filter_id_list_16bit_init(nr++, std_ids[0], std_ids[1],
+					      std_ids[2], std_ids[3], fifo,
+					      true);
+	}
+	if (n_masks) {
+		can_filter_id_mask_16bit_init(nr++, std_masks[0], std_masks[1],
+					      std_masks[0], std_masks[1], fifo,
+					      true);
+	}
+	if (n_ext) {
+		can_filter_id_list_32bit_init(nr++, ext[0], ext[0], fifo,
+					      true);
+	}
+
+	CAN_FMR(CAN1) |= CAN_FMR_FINIT;
+	for (i = nr; i < first + banks; i++) {
+		CAN_FA1R(CAN1) &= ~(1 << i);
+	}
+	CAN_FMR(CAN1) &= ~CAN_FMR_FINIT;
+
+	if (widened) {
+		*widened = work.widened;
+	}
+	return nr - first;
+}
+
 /*---------------------------------------------------------------------------*/
 /** @brief CAN Enable IRQ
 
@@ -548,3 +853,280 @@ bool can_available_mailbox(uint32_t canport)
 {
 	return CAN_TSR(canport) & (CAN_TSR_TME0 | CAN_TSR_TME1 | CAN_TSR_TME2);
 }
+
+/* --- Queued driver ------------------------------------------------------- */
+
+/* Arbitration key of a frame, laid out as CAN_TIxR: a lower key wins the bus
+ * arbitration. A standard frame beats an extended one with the same base
+ * identifier, a data frame beats a remote frame. */
+static uint32_t can_frame_key(const struct can_frame *frame)
+{
+	uint32_t key;
+
+	if (frame->ext) {
+		key = (frame->id << CAN_TIxR_EXID_SHIFT) | CAN_TIxR_IDE;
+	} else {
+		key = frame->id << CAN_TIxR_STID_SHIFT;
+	}
+	if (frame->rtr) {
+		key |= CAN_TIxR_RTR;
+	}
+	return key;
+}
+
+/* The queue is sorted by descending key, so the next frame to be sent is the
+ * last one. Frames with the same key leave in submission order, a frame put
+ * back after an abort goes ahead of the ones queued after it. */
+static void can_queue_insert(struct can_queue *queue,
+			     const struct can_frame *frame, bool requeue)
+{
+	uint32_t key = can_frame_key(frame);
+	uint16_t i = queue->tx_count;
+
+	while (i > 0) {
+		uint32_t k = can_frame_key(&queue->tx_buf[i - 1]);
+
+		if (requeue ? (k >= key) : (k > key)) {
+			break;
+		}
+		queue->tx_buf[i] = queue->tx_buf[i - 1];
+		i--;
+	}
+	queue->tx_buf[i] = *frame;
+	queue->tx_count++;
+}
+
+/* Must run with the TX interrupt masked. Collects the finished mailboxes,
+ * loads the empty ones from the queue and, if all mailboxes are busy with
+ * frames losing against the queue head, aborts the worst of them so that it
+ * cannot block the head from the bus. */
+static void can_queue_service(struct can_queue *queue)
+{
+	uint32_t canport = queue->canport;
+	uint32_t tsr = CAN_TSR(canport);
+	uint32_t busy;
+	uint32_t key = 0;
+	int worst = -1;
+	int n;
+
+	for (n = 0; n < 3; n++) {
+		if (!(tsr & (CAN_TSR_RQCP0 << (8 * n)))) {
+			continue;
+		}
+		CAN_TSR(canport) = CAN_TSR_RQCP0 << (8 * n);
+		if (!(tsr & (CAN_TSR_TXOK0 << (8 * n)))) {
+			if (queue->mbox_abort & (1 << n)) {
+				can_queue_insert(queue, &queue->mbox[n], true);
+			} else {
+				queue->tx_errors++;
+			}
+		}
+		queue->mbox_abort &= ~(1 << n);
+	}
+
+	while (queue->tx_count) {
+		struct can_frame *frame = &queue->tx_buf[queue->tx_count - 1];
+
+		key = can_frame_key(frame);
+		tsr = CAN_TSR(canport);
+		worst = -1;
+		for (n = 0; n < 3; n++) {
+			if (tsr & (CAN_TSR_TME0 << n)) {
+				continue;
+			}
+			busy = can_frame_key(&queue->mbox[n]);
+			/* Mailboxes with the same identifier are sent in
+			 * mailbox order, not in load order. */
+			if (busy == key) {
+				return;
+			}
+			if ((worst < 0) ||
+			    (busy > can_frame_key(&queue->mbox[worst]))) {
+				worst = n;
+			}
+		}
+		if (!(tsr & (CAN_TSR_TME0 | CAN_TSR_TME1 | CAN_TSR_TME2))) {
+			break;
+		}
+		n = can_transmit(canport, frame->id, frame->ext, frame->rtr,
+				 frame->length, frame->data);
+		queue->mbox[n] = *frame;
+		queue->tx_count--;
+	}
+
+	if (queue->tx_count && !queue->mbox_abort && (worst >= 0) &&
+	    (key < can_frame_key(&queue->mbox[worst]))) {
+		queue->mbox_abort = 1 << worst;
+		CAN_TSR(canport) = CAN_TSR_ABRQ0 << (8 * worst);
+	}
+}
+
+static void can_queue_drain(struct can_queue *queue, uint8_t fifo)
+{
+	uint32_t canport = queue->canport;
+	struct can_frame *frame;
+	uint16_t next;
+
+	/* Check before can_fifo_release() clears the flag. */
+	if ((fifo ? CAN_RF1R(canport) : CAN_RF0R(canport)) & CAN_RF0R_FOVR0) {
+		queue->rx_fifo_overruns++;
+		if (fifo) {
+			CAN_RF1R(canport) = CAN_RF1R_FOVR1;
+		} else {
+			CAN_RF0R(canport) = CAN_RF0R_FOVR0;
+		}
+	}
+
+	while ((fifo ? CAN_RF1R(canport) : CAN_RF0R(canport)) &
+	       CAN_RF0R_FMP0_MASK) {
+		next = queue->rx_head + 1;
+		if (next == queue->rx_size) {
+			next = 0;
+		}
+		if (next == queue->rx_tail) {
+			queue->rx_overruns++;
+			can_fifo_release(canport, fifo);
+			continue;
+		}
+
+		frame = &queue->rx_buf[queue->rx_head];
+		can_receive(canport, fifo, true, &frame->id, &frame->ext,
+			    &frame->rtr, &frame->fmi, &frame->length,
+			    frame->data, &frame->timestamp);
+		queue->rx_head = next;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief CAN Initialise a queued driver
+
+Frames are sent from a software queue kept sorted by identifier, so the
+mailboxes always carry the frames with the highest priority: when all three
+mailboxes are busy and a frame with a better identifier is queued, the worst
+pending mailbox is aborted and its frame is queued again. Received frames are
+moved from both FIFOs to a ring by the receive interrupts.
+
+The peripheral must be initialised with can_init() with txfp false (mailbox
+priority by identifier). The application enables the transmit and both FIFO
+interrupts in the NVIC and calls can_queue_tx_irq_handler() and
+can_queue_rx_irq_handler() from them. The transmit mailbox empty, FIFO message
+pending and FIFO overrun interrupts are enabled here.
+
+@param[in] queue queue to initialise
+@param[in] canport Unsigned int32. CAN block register base @ref can_reg_base.
+@param[in] tx_buf storage for the TX queue
+@param[in] tx_size number of frames in tx_buf
+@param[in] rx_buf storage for the RX ring
+@param[in] rx_size number of frames in rx_buf, holds rx_size - 1 frames
+*/
+
+void can_queue_init(struct can_queue *queue, uint32_t canport,
+		    struct can_frame *tx_buf, uint16_t tx_size,
+		    struct can_frame *rx_buf, uint16_t rx_size)
+{
+	queue->canport = canport;
+	queue->tx_buf = tx_buf;
+	queue->tx_size = tx_size;
+	queue->tx_count = 0;
+	queue->rx_buf = rx_buf;
+	queue->rx_size = rx_size;
+	queue->rx_head = 0;
+	queue->rx_tail = 0;
+	queue->rx_overruns = 0;
+	queue->rx_fifo_overruns = 0;
+	queue->tx_errors = 0;
+	queue->mbox_abort = 0;
+
+	can_enable_irq(canport, CAN_IER_TMEIE |
+		       CAN_IER_FMPIE0 | CAN_IER_FOVIE0 |
+		       CAN_IER_FMPIE1 | CAN_IER_FOVIE1);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief CAN Queue a frame for transmission
+
+@param[in] queue CAN queue
+@param[in] frame frame to send, copied into the queue
+@returns true if queued, false if the queue is full
+*/
+
+bool can_queue_transmit(struct can_queue *queue,
+			const struct can_frame *frame)
+{
+	bool ret = false;
+
+	CM_ATOMIC_BLOCK() {
+		/* Keep room for a frame coming back from an aborted mailbox. */
+		if (queue->tx_count + (queue->mbox_abort ? 1 : 0) <
+		    queue->tx_size) {
+			can_queue_insert(queue, frame, false);
+			ret = true;
+		}
+		can_queue_service(queue);
+	}
+	return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief CAN Get a received frame from the queue
+
+@param[in] queue CAN queue
+@param[out] frame received frame
+@returns true if a frame was returned, false if the ring is empty
+*/
+
+bool can_queue_receive(struct can_queue *queue, struct can_frame *frame)
+{
+	uint16_t tail = queue->rx_tail;
+
+	if (tail == queue->rx_head) {
+		return false;
+	}
+	*frame = queue->rx_buf[tail];
+	if (++tail == queue->rx_size) {
+		tail = 0;
+	}
+	queue->rx_tail = tail;
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief CAN Number of frames in the receive ring
+
+@param[in] queue CAN queue
+@returns number of frames can_queue_receive() can return
+*/
+
+uint16_t can_queue_rx_available(const struct can_queue *queue)
+{
+	return (queue->rx_head + queue->rx_size - queue->rx_tail) %
+	       queue->rx_size;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief CAN Transmit interrupt handler for the queued driver
+
+@param[in] queue CAN queue
+*/
+
+void can_queue_tx_irq_handler(struct can_queue *queue)
+{
+	can_queue_service(queue);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief CAN Receive interrupt handler for the queued driver
+
+Drains both FIFOs, so it may be called from the FIFO 0 and the FIFO 1
+interrupt. Frames that do not fit into the ring are dropped and counted in
+can_queue::rx_overruns, frames lost by the hardware in
+can_queue::rx_fifo_overruns.
+
+@param[in] queue CAN queue
+*/
+
+void can_queue_rx_irq_handler(struct can_queue *queue)
+{
+	can_queue_drain(queue, 0);
+	can_queue_drain(queue, 1);
+}
@@ -1,6 +1,27 @@
 /** @addtogroup crc_file CRC peripheral API
 @ingroup peripheral_apis
 
+Besides the raw register access, a streaming API calculates byte oriented
+CRCs described by @ref crc_params. The CRC unit is used where it supports the
+algorithm: any 7, 8, 16 or 32 bit polynomial on CRC units with a programmable
+polynomial, CRC-32 words on the others (F1/F2/F4/L1). Everything else,
+including the unaligned bytes on the latter, is calculated in software with
+the same result. The register value is kept in @ref crc_stream and loaded into
+the CRC unit for each update, so several calculations can be interleaved, but
+the CRC unit itself is not reentrant: updates must not be called from
+interrupts that may preempt another update.
+
+Example:
+@code
+	struct crc_stream crc;
+
+	crc_stream_init(&crc, &crc_preset_crc32);
+	crc_stream_update(&crc, hdr, sizeof(hdr));
+	crc_stream_update_dma(&crc, image, image_len, DMA2, DMA_STREAM0);
+	while (crc_stream_dma_busy(&crc));
+	check = crc_stream_final(&crc);
+@endcode
+
 @author @htmlonly &copy; @endhtmlonly 2012 Karl Palsson <karlp@remake.is>
 
 */
@@ -25,6 +46,7 @@
  */
 
 #include <libopencm3/stm32/crc.h>
+#include "dma_common_periph.h"
 
 /**@{*/
 
@@ -50,5 +72,352 @@ uint32_t crc_calculate_block(uint32_t *datap, int size)
 
 	return CRC_DR;
 }
+
+const struct crc_params crc_preset_crc32 = {
+	.poly = 0x04C11DB7, .init = 0xFFFFFFFF, .xorout = 0xFFFFFFFF,
+	.width = 32, .reflect = true,
+};
+
+const struct crc_params crc_preset_crc16_ccitt = {
+	.poly = 0x1021, .init = 0xFFFF, .xorout = 0,
+	.width = 16, .reflect = false,
+};
+
+const struct crc_params crc_preset_crc8 = {
+	.poly = 0x07, .init = 0, .xorout = 0,
+	.width = 8, .reflect = false,
+};
+
+#define CRC_POLY_CRC32		0x04C11DB7
+
+static uint32_t crc_width_mask(uint8_t width)
+{
+	return (width >= 32) ? 0xFFFFFFFF : ((1UL << width) - 1);
+}
+
+static uint32_t crc_reflect32(uint32_t x)
+{
+	x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+	x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+	x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+	return __builtin_bswap32(x);
+}
+
+/* Bitwise, MSB first on the left aligned register, bytes reflected for the
+ * reflected algorithms. Only used for what the CRC unit can't do. */
+static uint32_t crc_sw_update(const struct crc_params *params, uint32_t state,
+			      const uint8_t *data, size_t len)
+{
+	uint8_t shift = 32 - params->width;
+	uint32_t poly = params->poly << shift;
+	int i;
+
+	state <<= shift;
+	while (len--) {
+		uint32_t b = *data++;
+
+		if (params->reflect) {
+			b = crc_reflect32(b);
+		} else {
+			b <<= 24;
+		}
+		state ^= b;
+		for (i = 0; i < 8; i++) {
+			if (state & 0x80000000) {
+				state = (state << 1) ^ poly;
+			} else {
+				state <<= 1;
+			}
+		}
+	}
+	return state >> shift;
+}
+
+static bool crc_hw_supported(const struct crc_params *params)
+{
+#if defined(CRC_POL)
+	return (params->width == 7 || params->width == 8 ||
+		params->width == 16 || params->width == 32) &&
+		(params->poly & 1);
+#else
+	return params->width == 32 && params->poly == CRC_POLY_CRC32;
+#endif
+}
+
+#if defined(CRC_POL)
+
+static void crc_hw_load(const struct crc_params *params, uint32_t state)
+{
+	uint32_t polysize;
+
+	switch (params->width) {
+	case 7:
+		polysize = CRC_CR_POLYSIZE_7;
+		break;
+	case 8:
+		polysize = CRC_CR_POLYSIZE_8;
+		break;
+	case 16:
+		polysize = CRC_CR_POLYSIZE_16;
+		break;
+	default:
+		polysize = CRC_CR_POLYSIZE_32;
+		break;
+	}
+	CRC_CR = polysize;
+	CRC_POL = params->poly;
+	CRC_INIT = state;
+	CRC_CR = polysize | CRC_CR_RESET;
+}
+
+/* The CRC unit processes each access MSB first. Reflected algorithms use the
+ * bit reversal of the access size, the others swap the bytes of the access so
+ * that the lowest addressed byte comes first. */
+static void crc_hw_rev_in(bool reflect, uint32_t rev_in)
+{
+	CRC_CR = (CRC_CR & ~CRC_CR_REV_IN) |
+		 (reflect ? rev_in : CRC_CR_REV_IN_NONE);
+}
+
+static uint32_t crc_hw_update(const struct crc_params *params, uint32_t state,
+			      const uint8_t *data, size_t len)
+{
+	bool reflect = params->reflect;
+
+	crc_hw_load(params, state);
+
+	crc_hw_rev_in(reflect, CRC_CR_REV_IN_BYTE);
+	while (len && ((uintptr_t)data & 3)) {
+		CRC_DR8 = *data++;
+		len--;
+	}
+
+	crc_hw_rev_in(reflect, CRC_CR_REV_IN_WORD);
+	while (len >= 4) {
+		uint32_t w = *(const uint32_t *)data;
+
+		CRC_DR = reflect ? w : __builtin_bswap32(w);
+		data += 4;
+		len -= 4;
+	}
+
+	if (len >= 2) {
+		uint16_t h = *(const uint16_t *)data;
+
+		crc_hw_rev_in(reflect, CRC_CR_REV_IN_HALF);
+		CRC_DR16 = reflect ? h : __builtin_bswap16(h);
+		data += 2;
+		len -= 2;
+	}
+	if (len) {
+		crc_hw_rev_in(reflect, CRC_CR_REV_IN_BYTE);
+		CRC_DR8 = *data;
+	}
+
+	return CRC_DR & crc_width_mask(params->width);
+}
+
+#else
+
+/* The CRC unit starts from 0xFFFFFFFF after a reset. Writing W shifts
+ * (0xFFFFFFFF ^ W) through 32 steps, so a register value is restored by
+ * writing the 32 step inverse of it xored with 0xFFFFFFFF. */
+static void crc_hw_load(uint32_t state)
+{
+	int i;
+
+	CRC_CR = CRC_CR_RESET;
+	if (state == 0xFFFFFFFF) {
+		return;
+	}
+	for (i = 0; i < 32; i++) {
+		if (state & 1) {
+			state = ((state ^ CRC_POLY_CRC32) >> 1) | 0x80000000;
+		} else {
+			state >>= 1;
+		}
+	}
+	CRC_DR = state ^ 0xFFFFFFFF;
+}
+
+static uint32_t crc_hw_update(const struct crc_params *params, uint32_t state,
+			      const uint8_t *data, size_t len)
+{
+	size_t head = (4 - ((uintptr_t)data & 3)) & 3;
+
+	if (head > len) {
+		head = len;
+	}
+	state = crc_sw_update(params, state, data, head);
+	data += head;
+	len -= head;
+
+	if (len >= 4) {
+		crc_hw_load(state);
+		while (len >= 4) {
+			uint32_t w = *(const uint32_t *)data;
+
+			if (params->reflect) {
+				__asm__("rbit %0, %1" : "=r" (w) : "r" (w));
+			} else {
+				w = __builtin_bswap32(w);
+			}
+			CRC_DR = w;
+			data += 4;
+			len -= 4;
+		}
+		state = CRC_DR;
+	}
+
+	return crc_sw_update(params, state, data, len);
+}
+
+#endif
+
+void crc_stream_init(struct crc_stream *stream,
+		     const struct crc_params *params)
+{
+	stream->params = params;
+	stream->state = params->init & crc_width_mask(params->width);
+	stream->chunk = 0;
+	stream->left = 0;
+}
+
+void crc_stream_update(struct crc_stream *stream, const void *data,
+		       size_t len)
+{
+	const struct crc_params *params = stream->params;
+
+	if (len == 0) {
+		return;
+	}
+	if (crc_hw_supported(params)) {
+		stream->state = crc_hw_update(params, stream->state, data, len);
+	} else {
+		stream->state = crc_sw_update(params, stream->state, data, len);
+	}
+}
+
+#if defined(CRC_POL)
+
+/* Reflected algorithms are fed by words with the word bit reversal, the others
+ * by bytes as there is no DMA byte swap. */
+static uint8_t crc_dma_width(const struct crc_stream *stream)
+{
+	return stream->params->reflect ? 4 : 1;
+}
+
+static void crc_dma_chunk(struct crc_stream *stream)
+{
+	uint8_t width = crc_dma_width(stream);
+	size_t count = stream->left / width;
+
+	if (count > 0xFFFF) {
+		count = 0xFFFF;
+	}
+	stream->chunk = count * width;
+	dma_mem_setup(stream->dma, stream->ch, (uint32_t)stream->next,
+		      (uint32_t)&CRC_DR, count, width);
+	dma_enable_transfer_complete_interrupt(stream->dma, stream->ch);
+	dma_enable_transfer_error_interrupt(stream->dma, stream->ch);
+	stream->next += stream->chunk;
+	stream->left -= stream->chunk;
+	dma_periph_enable(stream->dma, stream->ch);
+}
+
+#endif
+
+void crc_stream_update_dma(struct crc_stream *stream, const void *data,
+			   size_t len, uint32_t dma, uint8_t ch)
+{
+#if defined(CRC_POL)
+	const uint8_t *buf = data;
+	size_t head = 0;
+
+	if (crc_hw_supported(stream->params) && len >= 16) {
+		if (crc_dma_width(stream) == 4) {
+			head = (4 - ((uintptr_t)buf & 3)) & 3;
+		}
+		crc_stream_update(stream, buf, head);
+		crc_hw_load(stream->params, stream->state);
+		crc_hw_rev_in(stream->params->reflect, CRC_CR_REV_IN_WORD);
+
+		stream->dma = dma;
+		stream->ch = ch;
+		stream->next = buf + head;
+		stream->left = len - head;
+		crc_dma_chunk(stream);
+		return;
+	}
+#else
+	(void)dma;
+	(void)ch;
+#endif
+	crc_stream_update(stream, data, len);
+}
+
+bool crc_stream_dma_busy(struct crc_stream *stream)
+{
+#if defined(CRC_POL)
+	uint8_t width;
+	size_t rest;
+	bool error;
+
+	if (stream->chunk == 0) {
+		return false;
+	}
+	error = dma_get_interrupt_flag(stream->dma, stream->ch, DMA_TEIF);
+	if (!error && !dma_get_interrupt_flag(stream->dma, stream->ch,
+					      DMA_TCIF)) {
+		return true;
+	}
+	dma_periph_disable(stream->dma, stream->ch);
+	dma_clear_interrupt_flags(stream->dma, stream->ch,
+				  DMA_TCIF | DMA_TEIF);
+
+	/* After an error the CRC unit holds the bytes that were transferred,
+	 * the rest is added by the CPU. */
+	width = crc_dma_width(stream);
+	rest = dma_get_number_of_data(stream->dma, stream->ch) * width;
+	stream->next -= rest;
+	stream->left += rest;
+	stream->chunk = 0;
+
+	if (!error && stream->left >= width) {
+		crc_dma_chunk(stream);
+		return true;
+	}
+
+	stream->state = CRC_DR & crc_width_mask(stream->params->width);
+	rest = stream->left;
+	stream->left = 0;
+	crc_stream_update(stream, stream->next, rest);
+#else
+	(void)stream;
+#endif
+	return false;
+}
+
+uint32_t crc_stream_final(const struct crc_stream *stream)
+{
+	const struct crc_params *params = stream->params;
+	uint32_t crc = stream->state;
+
+	if (params->reflect) {
+		crc = crc_reflect32(crc) >> (32 - params->width);
+	}
+	return (crc ^ params->xorout) & crc_width_mask(params->width);
+}
+
+uint32_t crc_compute(const struct crc_params *params, const void *data,
+		     size_t len)
+{
+	struct crc_stream stream;
+
+	crc_stream_init(&stream, params);
+	crc_stream_update(&stream, data, len);
+	return crc_stream_final(&stream);
+}
+
 /**@}*/
 
@@ -9,6 +9,13 @@
  * This library supports the cryptographic coprocessor system for the
  * STM32 series of ARM Cortex Microcontrollers
  *
+ * Besides the register level functions, streaming contexts encrypt or decrypt
+ * byte buffers in several calls: crypto_context_init() and any number of
+ * crypto_context_process() or crypto_context_process_dma(). Key and IV are
+ * loaded for each call and the IV is read back afterwards, so CBC and CTR
+ * chaining is preserved and contexts can be interleaved. On F42x/F43x,
+ * crypto_aead_start() and crypto_aead_finish() add GCM and CCM.
+ *
  * LGPL License Terms @ref lgpl_license
  */
 /*
@@ -33,6 +40,7 @@
 /**@{*/
 
 #include <libopencm3/stm32/crypto.h>
+#include "dma_common_periph.h"
 
 #define CRYP_CR_ALGOMODE_MASK	((1 << 19) | CRYP_CR_ALGOMODE)
 
@@ -172,4 +180,494 @@ uint32_t crypto_process_block(uint32_t *inp, uint32_t *outp, uint32_t length)
 	return wr;
 }
 
+/* Key and IV registers, left/right halves as consecutive words */
+#define CRYP_KWR(i)		MMIO32(CRYP_BASE + 0x20 + (i) * 4)
+#define CRYP_IVWR(i)		MMIO32(CRYP_BASE + 0x40 + (i) * 4)
+
+/* Words per DMA transfer, a multiple of the block size */
+#define CRYPTO_DMA_MAX		0xFFFC
+
+/* The data type is 8 bit, so data words are used in memory order, while the
+ * key and IV registers take big endian numbers. */
+static uint32_t crypto_get_word(const uint8_t *p)
+{
+	if (((uintptr_t)p & 3) == 0) {
+		return *(const uint32_t *)p;
+	}
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void crypto_put_word(uint8_t *p, uint32_t w)
+{
+	if (((uintptr_t)p & 3) == 0) {
+		*(uint32_t *)p = w;
+		return;
+	}
+	p[0] = w;
+	p[1] = w >> 8;
+	p[2] = w >> 16;
+	p[3] = w >> 24;
+}
+
+static uint32_t crypto_get_be32(const uint8_t *p)
+{
+	return __builtin_bswap32(crypto_get_word(p));
+}
+
+static bool crypto_is_aes(uint32_t cr)
+{
+	return (cr & CRYP_CR_ALGOMODE) >= CRYP_CR_ALGOMODE_AES_ECB;
+}
+
+/* Keys end at K3RR, except DES which uses K1. */
+static void crypto_load_key(const struct crypto_context *ctx)
+{
+	uint32_t first = (ctx->keylen == 8) ? 2 : 8 - ctx->keylen / 4;
+	uint32_t i;
+
+	for (i = 0; i < ctx->keylen / 4u; i++) {
+		CRYP_KWR(first + i) = crypto_get_be32(ctx->key + 4 * i);
+	}
+}
+
+/* Load key and IV and enable the controller, for AEAD just resume. */
+static void crypto_resume(struct crypto_context *ctx)
+{
+	uint32_t mode = ctx->cr & CRYP_CR_ALGOMODE;
+	uint32_t i;
+
+	crypto_wait_busy();
+	if (ctx->aead) {
+		CRYP_CR |= CRYP_CR_CRYPEN;
+		return;
+	}
+
+	CRYP_CR = (ctx->cr & CRYP_CR_KEYSIZE) | CRYP_CR_DATATYPE_8;
+	crypto_load_key(ctx);
+	if ((ctx->cr & CRYP_CR_ALGODIR) &&
+	    (mode == CRYP_CR_ALGOMODE_AES_ECB ||
+	     mode == CRYP_CR_ALGOMODE_AES_CBC)) {
+		/* Decryption key schedule, CRYPEN clears when done */
+		CRYP_CR |= CRYP_CR_ALGODIR | CRYP_CR_ALGOMODE_AES_PREP |
+			   CRYP_CR_CRYPEN;
+		crypto_wait_busy();
+	}
+
+	CRYP_CR = ctx->cr | CRYP_CR_DATATYPE_8;
+	for (i = 0; i < ctx->block / 4u; i++) {
+		CRYP_IVWR(i) = ctx->iv[i];
+	}
+	CRYP_CR |= CRYP_CR_FFLUSH;
+	CRYP_CR |= CRYP_CR_CRYPEN;
+}
+
+/* Disable the controller and keep the updated IV for the next call. */
+static void crypto_suspend(struct crypto_context *ctx)
+{
+	uint32_t i;
+
+	crypto_wait_busy();
+	CRYP_CR &= ~CRYP_CR_CRYPEN;
+	for (i = 0; !ctx->aead && i < ctx->block / 4u; i++) {
+		ctx->iv[i] = CRYP_IVWR(i);
+	}
+}
+
+static void crypto_feed(const uint8_t *in, uint8_t *out, size_t words)
+{
+	size_t rd = 0, wr = 0;
+
+	while (rd != words) {
+		if ((wr < words) && (CRYP_SR & CRYP_SR_IFNF)) {
+			CRYP_DIN = crypto_get_word(in);
+			in += 4;
+			wr++;
+		}
+
+		if (CRYP_SR & CRYP_SR_OFNE) {
+			crypto_put_word(out, CRYP_DOUT);
+			out += 4;
+			rd++;
+		}
+	}
+}
+
+/**
+ * @brief Initialise a streaming context
+ *
+ * @param[out] ctx context
+ * @param[in] mode enum crypto_mode ECB, CBC or CTR mode and direction
+ * @param[in] key key bytes, must stay valid while the context is used
+ * @param[in] keylen 16, 24 or 32 for AES, 8 for DES, 24 for TDES
+ * @param[in] iv IV or initial counter block (8 bytes for DES/TDES, 16 for
+ * AES), NULL for ECB
+ */
+void crypto_context_init(struct crypto_context *ctx, enum crypto_mode mode,
+			 const uint8_t *key, size_t keylen, const uint8_t *iv)
+{
+	uint32_t i;
+
+	ctx->cr = mode;
+	ctx->key = key;
+	ctx->keylen = keylen;
+	ctx->aead = false;
+	ctx->aadlen = 0;
+	ctx->msglen = 0;
+	ctx->chunk = 0;
+	ctx->left = 0;
+	ctx->dma_error = false;
+	ctx->block = 8;
+	if (crypto_is_aes(mode)) {
+		ctx->block = 16;
+		if (keylen == 24) {
+			ctx->cr |= CRYP_CR_KEYSIZE_192;
+		} else if (keylen == 32) {
+			ctx->cr |= CRYP_CR_KEYSIZE_256;
+		}
+	}
+
+	for (i = 0; i < 4; i++) {
+		ctx->iv[i] = 0;
+	}
+	for (i = 0; iv && i < ctx->block / 4u; i++) {
+		ctx->iv[i] = crypto_get_be32(iv + 4 * i);
+	}
+}
+
+/**
+ * @brief Encrypt or decrypt the next part of a stream
+ *
+ * The length must be a multiple of the block size, except for the last call
+ * of CTR, GCM and CCM streams.
+ *
+ * @param[in] ctx context
+ * @param[in] in input bytes, any alignment
+ * @param[out] out output bytes, any alignment, may be the same as in
+ * @param[in] len number of bytes
+ */
+void crypto_context_process(struct crypto_context *ctx, const void *in,
+			    void *out, size_t len)
+{
+	const uint8_t *src = in;
+	uint8_t *dst = out;
+	size_t full = len - len % ctx->block;
+
+	crypto_resume(ctx);
+	crypto_feed(src, dst, full / 4);
+
+	if (len != full) {
+		uint8_t pad[16] = { 0 };
+		size_t i;
+
+		for (i = 0; i < len - full; i++) {
+			pad[i] = src[full + i];
+		}
+		crypto_feed(pad, pad, ctx->block / 4);
+		for (i = 0; i < len - full; i++) {
+			dst[full + i] = pad[i];
+		}
+	}
+
+	crypto_suspend(ctx);
+	ctx->msglen += len;
+}
+
+static void crypto_dma_chunk(struct crypto_context *ctx)
+{
+	size_t words = ctx->left / 4;
+
+	if (words > CRYPTO_DMA_MAX) {
+		words = CRYPTO_DMA_MAX;
+	}
+	ctx->chunk = words * 4;
+
+	dma_periph_setup(ctx->dma, ctx->out_ch, (uint32_t)&CRYP_DOUT,
+			 (uint32_t)ctx->out, words, 4, false, true);
+	dma_enable_transfer_complete_interrupt(ctx->dma, ctx->out_ch);
+	dma_enable_transfer_error_interrupt(ctx->dma, ctx->out_ch);
+	dma_periph_setup(ctx->dma, ctx->in_ch, (uint32_t)&CRYP_DIN,
+			 (uint32_t)ctx->in, words, 4, true, true);
+	ctx->in += ctx->chunk;
+	ctx->out += ctx->chunk;
+	ctx->left -= ctx->chunk;
+
+	dma_periph_enable(ctx->dma, ctx->out_ch);
+	dma_periph_enable(ctx->dma, ctx->in_ch);
+	CRYP_DMACR = CRYP_DMACR_DIEN | CRYP_DMACR_DOEN;
+}
+
+/**
+ * @brief Encrypt or decrypt the next part of a stream by DMA
+ *
+ * The CPU is free until crypto_dma_busy() returns false. Buffers that are not
+ * word aligned or not a multiple of the block size are processed by the CPU.
+ * The application maps the CRYP DMA requests (DMA2 stream 6 for IN and stream
+ * 5 for OUT, channel 2 on F2/F4).
+ *
+ * @param[in] ctx context
+ * @param[in] in input bytes, must stay valid until finished
+ * @param[out] out output bytes, may be the same as in
+ * @param[in] len number of bytes
+ * @param[in] dma DMA controller
+ * @param[in] in_ch DMA stream serving the IN request
+ * @param[in] out_ch DMA stream serving the OUT request
+ */
+void crypto_context_process_dma(struct crypto_context *ctx, const void *in,
+				void *out, size_t len, uint32_t dma,
+				uint8_t in_ch, uint8_t out_ch)
+{
+	if (len == 0 || (len % ctx->block) ||
+	    (((uintptr_t)in | (uintptr_t)out) & 3)) {
+		crypto_context_process(ctx, in, out, len);
+		return;
+	}
+
+	ctx->dma = dma;
+	ctx->in_ch = in_ch;
+	ctx->out_ch = out_ch;
+	ctx->in = in;
+	ctx->out = out;
+	ctx->left = len;
+	ctx->msglen += len;
+	crypto_resume(ctx);
+	crypto_dma_chunk(ctx);
+}
+
+/**
+ * @brief Check for the end of a DMA transfer and continue it
+ *
+ * Can be polled or called from the interrupt of the OUT DMA stream. A transfer
+ * error ends the transfer too, check crypto_dma_error() afterwards.
+ *
+ * @param[in] ctx context
+ * @returns true while the transfer started by crypto_context_process_dma()
+ * is running
+ */
+bool crypto_dma_busy(struct crypto_context *ctx)
+{
+	bool error;
+
+	if (ctx->chunk == 0) {
+		return false;
+	}
+	error = dma_get_interrupt_flag(ctx->dma, ctx->out_ch, DMA_TEIF) ||
+		dma_get_interrupt_flag(ctx->dma, ctx->in_ch, DMA_TEIF);
+	if (!error && !dma_get_interrupt_flag(ctx->dma, ctx->out_ch,
+					      DMA_TCIF)) {
+		return true;
+	}
+
+	CRYP_DMACR = 0;
+	dma_periph_disable(ctx->dma, ctx->in_ch);
+	dma_periph_disable(ctx->dma, ctx->out_ch);
+	dma_clear_interrupt_flags(ctx->dma, ctx->in_ch, DMA_TCIF | DMA_TEIF);
+	dma_clear_interrupt_flags(ctx->dma, ctx->out_ch, DMA_TCIF | DMA_TEIF);
+	ctx->chunk = 0;
+
+	if (!error && ctx->left) {
+		crypto_dma_chunk(ctx);
+		return true;
+	}
+	if (error) {
+		ctx->dma_error = true;
+	}
+	ctx->left = 0;
+	crypto_suspend(ctx);
+	return false;
+}
+
+/**
+ * @brief Check for a failed DMA transfer
+ *
+ * The error sticks until the context is initialised again: the output of
+ * the failed transfer is incomplete and the chaining state is lost.
+ *
+ * @param[in] ctx context
+ * @returns true if a transfer of crypto_context_process_dma() failed
+ */
+bool crypto_dma_error(const struct crypto_context *ctx)
+{
+	return ctx->dma_error;
+}
+
+#if defined(CRYP_CR_ALGOMODE3)
+
+static void crypto_set_phase(uint32_t phase)
+{
+	crypto_wait_busy();
+	CRYP_CR &= ~CRYP_CR_CRYPEN;
+	CRYP_CR = (CRYP_CR & ~CRYP_CR_GCM_CMPH) | phase;
+}
+
+/* Write the concatenation of a and b, zero padded to whole blocks. */
+static void crypto_write_padded(const uint8_t *a, size_t alen,
+				const uint8_t *b, size_t blen)
+{
+	uint32_t word = 0;
+	size_t n = 0;
+
+	while (alen + blen || (n & 15)) {
+		uint32_t byte = 0;
+
+		if (alen) {
+			byte = *a++;
+			alen--;
+		} else if (blen) {
+			byte = *b++;
+			blen--;
+		}
+		word |= byte << (8 * (n & 3));
+		if ((++n & 3) == 0) {
+			while (!(CRYP_SR & CRYP_SR_IFNF));
+			CRYP_DIN = word;
+			word = 0;
+		}
+	}
+}
+
+/**
+ * @brief Start a GCM or CCM stream
+ *
+ * Runs the init and header phases, the payload is then processed with
+ * crypto_context_process() or crypto_context_process_dma() and the tag is
+ * calculated by crypto_aead_finish(). The hardware state is not saved, so
+ * only one GCM/CCM stream can run at a time.
+ *
+ * @note A payload that ends with a partial block gives a wrong tag for GCM
+ * encryption and CCM decryption on this hardware.
+ *
+ * @param[out] ctx context
+ * @param[in] mode enum crypto_mode_mac GCM or CCM and direction
+ * @param[in] key key bytes
+ * @param[in] keylen 16, 24 or 32
+ * @param[in] nonce 12 bytes for GCM, 7 to 13 bytes for CCM
+ * @param[in] noncelen length of the nonce
+ * @param[in] aad additional authenticated data
+ * @param[in] aadlen length of aad
+ * @param[in] msglen total payload length, needed by CCM only
+ * @param[in] taglen tag length (4 to 16, even), needed by CCM only
+ */
+void crypto_aead_start(struct crypto_context *ctx, enum crypto_mode_mac mode,
+		       const uint8_t *key, size_t keylen,
+		       const uint8_t *nonce, size_t noncelen,
+		       const uint8_t *aad, size_t aadlen,
+		       size_t msglen, size_t taglen)
+{
+	bool ccm = (mode & CRYP_CR_ALGOMODE) == CRYP_CR_ALGOMODE_TDES_CBC;
+	uint8_t b0[16] = { 0 };
+	uint8_t ctr[16] = { 0 };
+	uint8_t prefix[6];
+	size_t plen = 0;
+	size_t q = 15 - noncelen;
+	size_t i;
+
+	crypto_context_init(ctx, (enum crypto_mode)CRYP_CR_ALGOMODE_AES_ECB,
+			    key, keylen, NULL);
+	ctx->cr = (ctx->cr & ~CRYP_CR_ALGOMODE) | mode;
+	ctx->aead = true;
+	ctx->aadlen = aadlen;
+
+	if (ccm) {
+		/* B0 and counter blocks as in NIST SP 800-38C */
+		b0[0] = (aadlen ? 0x40 : 0) | (((taglen - 2) / 2) << 3) |
+			(q - 1);
+		ctr[0] = q - 1;
+		for (i = 0; i < noncelen; i++) {
+			b0[1 + i] = nonce[i];
+			ctr[1 + i] = nonce[i];
+		}
+		for (i = 0; i < q && i < sizeof(size_t); i++) {
+			b0[15 - i] = msglen >> (8 * i);
+		}
+		/* CTR0 encrypts the tag in the final phase */
+		for (i = 0; i < 4; i++) {
+			ctx->iv[i] = crypto_get_be32(ctr + 4 * i);
+		}
+		ctr[15] = 1;
+
+		if (aadlen >= 0xFF00) {
+			prefix[plen++] = 0xFF;
+			prefix[plen++] = 0xFE;
+			prefix[plen++] = aadlen >> 24;
+			prefix[plen++] = aadlen >> 16;
+		}
+		if (aadlen) {
+			prefix[plen++] = aadlen >> 8;
+			prefix[plen++] = aadlen;
+		}
+	} else {
+		for (i = 0; i < noncelen && i < 12; i++) {
+			ctr[i] = nonce[i];
+		}
+		ctr[15] = 2;
+	}
+
+	crypto_wait_busy();
+	CRYP_CR = ctx->cr | CRYP_CR_DATATYPE_8 | CRYP_CR_GCM_CMPH_INIT;
+	crypto_load_key(ctx);
+	for (i = 0; i < 4; i++) {
+		CRYP_IVWR(i) = crypto_get_be32(ctr + 4 * i);
+	}
+	CRYP_CR |= CRYP_CR_FFLUSH;
+	CRYP_CR |= CRYP_CR_CRYPEN;
+	if (ccm) {
+		crypto_write_padded(b0, sizeof(b0), NULL, 0);
+	}
+	/* CRYPEN clears at the end of the init phase */
+	while (CRYP_CR & CRYP_CR_CRYPEN);
+
+	if (aadlen) {
+		crypto_set_phase(CRYP_CR_GCM_CMPH_HEADER);
+		CRYP_CR |= CRYP_CR_CRYPEN;
+		crypto_write_padded(prefix, plen, aad, aadlen);
+		while (!(CRYP_SR & CRYP_SR_IFEM));
+	}
+
+	/* The payload calls enable the controller again */
+	crypto_set_phase(CRYP_CR_GCM_CMPH_PAYLOAD);
+}
+
+/**
+ * @brief Finish a GCM or CCM stream
+ *
+ * @param[in] ctx context
+ * @param[out] tag 16 bytes, for CCM only the first taglen bytes are used
+ * @returns false if a DMA transfer of the payload failed, tag is then left
+ * untouched
+ */
+bool crypto_aead_finish(struct crypto_context *ctx, uint8_t *tag)
+{
+	uint32_t i;
+
+	if (ctx->dma_error) {
+		CRYP_CR &= ~CRYP_CR_CRYPEN;
+		CRYP_CR |= CRYP_CR_FFLUSH;
+		return false;
+	}
+
+	crypto_set_phase(CRYP_CR_GCM_CMPH_FINAL);
+	CRYP_CR |= CRYP_CR_CRYPEN;
+	if ((ctx->cr & CRYP_CR_ALGOMODE) == CRYP_CR_ALGOMODE_TDES_CBC) {
+		for (i = 0; i < 4; i++) {
+			CRYP_DIN = __builtin_bswap32(ctx->iv[i]);
+		}
+	} else {
+		/* 64 bit bit lengths of the AAD and the payload */
+		CRYP_DIN = 0;
+		CRYP_DIN = __builtin_bswap32(ctx->aadlen * 8);
+		CRYP_DIN = 0;
+		CRYP_DIN = __builtin_bswap32(ctx->msglen * 8);
+	}
+
+	for (i = 0; i < 4; i++) {
+		while (!(CRYP_SR & CRYP_SR_OFNE));
+		crypto_put_word(tag + 4 * i, CRYP_DOUT);
+	}
+	crypto_wait_busy();
+	CRYP_CR &= ~CRYP_CR_CRYPEN;
+	return true;
+}
+
+#endif
+
 /**@}*/
@@ -26,8 +26,250 @@
  * along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/stm32/common/dma2d_common_f47.h>
 
 /**@{*/
 
+#define DMA2D_CR_IRQS	(DMA2D_CR_CEIE | DMA2D_CR_CAEIE | DMA2D_CR_TCIE | \
+			 DMA2D_CR_TEIE)
+#define DMA2D_ISR_ERRORS	(DMA2D_ISR_CEIF | DMA2D_ISR_CAEIF | \
+				 DMA2D_ISR_TEIF)
+#define DMA2D_IFCR_ALL	(DMA2D_IFCR_CCEIF | DMA2D_IFCR_CCTCIF | \
+			 DMA2D_IFCR_CCAEIF | DMA2D_IFCR_CTWIF | \
+			 DMA2D_IFCR_CTCIF | DMA2D_IFCR_CTEIF)
+
+static struct dma2d_op *volatile dma2d_queue_head;
+static struct dma2d_op *dma2d_queue_tail;
+
+static uint32_t dma2d_pfccr(const struct dma2d_buffer *buf)
+{
+	return ((uint32_t)buf->alpha << DMA2D_xPFCCR_ALPHA_SHIFT) |
+	       ((buf->am & DMA2D_xPFCCR_AM_MASK) << DMA2D_xPFCCR_AM_SHIFT) |
+	       ((buf->cm & DMA2D_xPFCCR_CM_MASK) << DMA2D_xPFCCR_CM_SHIFT);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief DMA2D Program an operation
+ *
+ * Loads the mode, output, foreground/background and size registers from the
+ * descriptor. The transfer is not started. Interrupt enable bits in DMA2D_CR
+ * are preserved. CLUT based input formats require the CLUT to be loaded
+ * separately.
+ *
+ * @param[in] op operation to program
+ */
+void dma2d_setup_op(const struct dma2d_op *op)
+{
+	DMA2D_CR = (DMA2D_CR & ~(DMA2D_CR_MODE_MASK << DMA2D_CR_MODE_SHIFT)) |
+		   ((op->mode & DMA2D_CR_MODE_MASK) << DMA2D_CR_MODE_SHIFT);
+
+	DMA2D_OPFCCR = op->out.cm & DMA2D_OPFCCR_CM_MASK;
+	DMA2D_OMAR = op->out.addr;
+	DMA2D_OOR = op->out.offset & DMA2D_OOR_LO_MASK;
+	DMA2D_NLR = ((op->width & DMA2D_NLR_PL_MASK) << DMA2D_NLR_PL_SHIFT) |
+		    ((op->height & DMA2D_NLR_NL_MASK) << DMA2D_NLR_NL_SHIFT);
+
+	switch (op->mode) {
+	case DMA2D_CR_MODE_R2M:
+		DMA2D_OCOLR = op->color;
+		break;
+	case DMA2D_CR_MODE_M2MWB:
+		DMA2D_BGMAR = op->bg.addr;
+		DMA2D_BGOR = op->bg.offset & DMA2D_BGOR_LO_MASK;
+		DMA2D_BGPFCCR = dma2d_pfccr(&op->bg);
+		/* fall through */
+	default:
+		DMA2D_FGMAR = op->fg.addr;
+		DMA2D_FGOR = op->fg.offset & DMA2D_FGOR_LO_MASK;
+		DMA2D_FGPFCCR = dma2d_pfccr(&op->fg);
+		break;
+	}
+}
+
+/** @brief DMA2D Start the programmed transfer */
+void dma2d_start(void)
+{
+	DMA2D_CR |= DMA2D_CR_START;
+}
+
+/** @brief DMA2D Abort the running transfer */
+void dma2d_abort(void)
+{
+	DMA2D_CR |= DMA2D_CR_ABORT;
+}
+
+/** @brief DMA2D Check for a running transfer or queued operations
+ * @returns true if the DMA2D is running or operations are still queued
+ */
+bool dma2d_is_busy(void)
+{
+	return (DMA2D_CR & DMA2D_CR_START) || dma2d_queue_head;
+}
+
+/** @brief DMA2D Wait until the transfer and all queued operations are done */
+void dma2d_wait(void)
+{
+	while (dma2d_is_busy());
+}
+
+static void dma2d_run_blocking(const struct dma2d_op *op)
+{
+	dma2d_wait();
+	dma2d_setup_op(op);
+	DMA2D_IFCR = DMA2D_IFCR_ALL;
+	dma2d_start();
+	while (DMA2D_CR & DMA2D_CR_START);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief DMA2D Fill a rectangle with a constant colour (blocking)
+ *
+ * @param[in] out destination buffer, only addr, offset and cm are used
+ * @param[in] width pixels per line
+ * @param[in] height number of lines
+ * @param[in] color fill colour, in the output colour mode
+ */
+void dma2d_fill(const struct dma2d_buffer *out, uint16_t width,
+		uint16_t height, uint32_t color)
+{
+	struct dma2d_op op = {
+		.mode = DMA2D_CR_MODE_R2M,
+		.width = width,
+		.height = height,
+		.color = color,
+		.out = *out,
+	};
+
+	dma2d_run_blocking(&op);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief DMA2D Copy a rectangle, converting the pixel format (blocking)
+ *
+ * A plain memory to memory transfer is used when the foreground and output
+ * colour modes match and no alpha modification is requested, otherwise the
+ * pixel format converter is used.
+ *
+ * @param[in] out destination buffer
+ * @param[in] fg source buffer
+ * @param[in] width pixels per line
+ * @param[in] height number of lines
+ */
+void dma2d_copy(const struct dma2d_buffer *out, const struct dma2d_buffer *fg,
+		uint16_t width, uint16_t height)
+{
+	struct dma2d_op op = {
+		.mode = DMA2D_CR_MODE_M2MWPFC,
+		.width = width,
+		.height = height,
+		.out = *out,
+		.fg = *fg,
+	};
+
+	if (fg->cm == out->cm && fg->am == DMA2D_xPFCCR_AM_NONE) {
+		op.mode = DMA2D_CR_MODE_M2M;
+	}
+	dma2d_run_blocking(&op);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief DMA2D Blend a foreground over a background (blocking)
+ *
+ * The alpha of each layer is taken from the pixel data, the constant alpha or
+ * their product, as selected by the am and alpha fields of the buffers.
+ *
+ * @param[in] out destination buffer, may be the same as bg
+ * @param[in] fg foreground buffer
+ * @param[in] bg background buffer
+ * @param[in] width pixels per line
+ * @param[in] height number of lines
+ */
+void dma2d_blend(const struct dma2d_buffer *out, const struct dma2d_buffer *fg,
+		 const struct dma2d_buffer *bg, uint16_t width, uint16_t height)
+{
+	struct dma2d_op op = {
+		.mode = DMA2D_CR_MODE_M2MWB,
+		.width = width,
+		.height = height,
+		.out = *out,
+		.fg = *fg,
+		.bg = *bg,
+	};
+
+	dma2d_run_blocking(&op);
+}
+
+static void dma2d_queue_start(const struct dma2d_op *op)
+{
+	dma2d_setup_op(op);
+	DMA2D_IFCR = DMA2D_IFCR_ALL;
+	DMA2D_CR |= DMA2D_CR_IRQS | DMA2D_CR_START;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief DMA2D Queue an operation
+ *
+ * The operation is started immediately if the DMA2D is idle, otherwise it is
+ * started from dma2d_irq_handler() when the previous operation completes.
+ * The DMA2D interrupt must be enabled in the NVIC and dma2d_isr() must call
+ * dma2d_irq_handler().
+ *
+ * @param[in] op operation descriptor, must stay valid until completed
+ */
+void dma2d_submit(struct dma2d_op *op)
+{
+	op->status = DMA2D_OP_PENDING;
+	op->next = NULL;
+
+	CM_ATOMIC_BLOCK() {
+		if (dma2d_queue_head) {
+			dma2d_queue_tail->next = op;
+			dma2d_queue_tail = op;
+		} else {
+			dma2d_queue_head = op;
+			dma2d_queue_tail = op;
+			dma2d_queue_start(op);
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief DMA2D Interrupt handler for the operation queue
+ *
+ * Completes the running operation, starts the next queued one and then calls
+ * the completion callback of the finished operation.
+ */
+void dma2d_irq_handler(void)
+{
+	uint32_t isr = DMA2D_ISR;
+	struct dma2d_op *op = dma2d_queue_head;
+
+	DMA2D_IFCR = isr & DMA2D_IFCR_ALL;
+	if (!op) {
+		return;
+	}
+
+	if (isr & DMA2D_ISR_ERRORS) {
+		op->status = DMA2D_OP_ERROR;
+	} else if (isr & DMA2D_ISR_TCIF) {
+		op->status = DMA2D_OP_DONE;
+	} else {
+		return;
+	}
+
+	dma2d_queue_head = op->next;
+	if (dma2d_queue_head) {
+		dma2d_queue_start(dma2d_queue_head);
+	} else {
+		dma2d_queue_tail = NULL;
+		DMA2D_CR &= ~DMA2D_CR_IRQS;
+	}
+
+	if (op->callback) {
+		op->callback(op);
+	}
+}
+
 /**@}*/
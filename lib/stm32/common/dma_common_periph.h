@@ -0,0 +1,110 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This is a "private" header file for peripheral drivers that move data with
+ * the DMA controller. It hides the differences between the stream based
+ * (F2/F4/F7) and the channel based (F0/F1/F3/L0/L1/L4/G0/G4) DMA controllers.
+ * "ch" is the stream number on the former and the channel number on the
+ * latter. The request mapping (dma_channel_select(), dma_set_channel_request()
+ * or the DMAMUX) is left as configured by the application.
+ */
+
+#ifndef DMA_COMMON_PERIPH
+#define DMA_COMMON_PERIPH
+
+#include <libopencm3/stm32/dma.h>
+
+/* Program a single, non circular, peripheral <-> memory transfer.
+ * width is the transfer size in bytes (1, 2 or 4). The stream/channel is
+ * left disabled, with all of its interrupts disabled and flags cleared. */
+static inline void dma_periph_setup(uint32_t dma, uint8_t ch,
+				    uint32_t periph, uint32_t mem,
+				    uint16_t count, uint8_t width,
+				    bool to_periph, bool mem_inc)
+{
+#if defined(DMA_SxCR_EN)
+	uint32_t chsel = DMA_SCR(dma, ch) & DMA_SxCR_CHSEL_MASK;
+	uint32_t size = (width == 4) ? 2 : (width == 2) ? 1 : 0;
+
+	dma_stream_reset(dma, ch);
+	DMA_SCR(dma, ch) = chsel |
+		(size << DMA_SxCR_MSIZE_SHIFT) |
+		(size << DMA_SxCR_PSIZE_SHIFT) |
+		(to_periph ? DMA_SxCR_DIR_MEM_TO_PERIPHERAL :
+			     DMA_SxCR_DIR_PERIPHERAL_TO_MEM);
+#else
+	uint32_t size = (width == 4) ? 2 : (width == 2) ? 1 : 0;
+
+	dma_channel_reset(dma, ch);
+	DMA_CCR(dma, ch) = (size << DMA_CCR_MSIZE_SHIFT) |
+		(size << DMA_CCR_PSIZE_SHIFT) |
+		(to_periph ? DMA_CCR_DIR : 0);
+#endif
+	dma_set_peripheral_address(dma, ch, periph);
+	dma_set_memory_address(dma, ch, mem);
+	dma_set_number_of_data(dma, ch, count);
+	if (mem_inc) {
+		dma_enable_memory_increment_mode(dma, ch);
+	}
+}
+
+/* Program a single memory -> memory transfer from an incremented source to a
+ * fixed destination, e.g. a data register without a DMA request. On the
+ * stream based controllers only DMA2 can do memory to memory transfers. */
+static inline void dma_mem_setup(uint32_t dma, uint8_t ch, uint32_t src,
+				 uint32_t dst, uint16_t count, uint8_t width)
+{
+	uint32_t size = (width == 4) ? 2 : (width == 2) ? 1 : 0;
+
+#if defined(DMA_SxCR_EN)
+	dma_stream_reset(dma, ch);
+	DMA_SCR(dma, ch) = (size << DMA_SxCR_MSIZE_SHIFT) |
+		(size << DMA_SxCR_PSIZE_SHIFT) |
+		DMA_SxCR_DIR_MEM_TO_MEM | DMA_SxCR_PINC;
+	dma_set_peripheral_address(dma, ch, src);
+	dma_set_memory_address(dma, ch, dst);
+#else
+	dma_channel_reset(dma, ch);
+	DMA_CCR(dma, ch) = (size << DMA_CCR_MSIZE_SHIFT) |
+		(size << DMA_CCR_PSIZE_SHIFT) |
+		DMA_CCR_DIR | DMA_CCR_MEM2MEM | DMA_CCR_MINC;
+	dma_set_peripheral_address(dma, ch, dst);
+	dma_set_memory_address(dma, ch, src);
+#endif
+	dma_set_number_of_data(dma, ch, count);
+}
+
+static inline void dma_periph_enable(uint32_t dma, uint8_t ch)
+{
+#if defined(DMA_SxCR_EN)
+	dma_enable_stream(dma, ch);
+#else
+	dma_enable_channel(dma, ch);
+#endif
+}
+
+static inline void dma_periph_disable(uint32_t dma, uint8_t ch)
+{
+#if defined(DMA_SxCR_EN)
+	dma_disable_stream(dma, ch);
+#else
+	dma_disable_channel(dma, ch);
+#endif
+}
+
+#endif
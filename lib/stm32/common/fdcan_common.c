@@ -75,8 +75,9 @@ int fdcan_cccr_init_cfg(uint32_t canport, bool set, uint32_t timeout)
 
 /** Return ID of next free Tx buffer.
  *
- * Examines transmit buffer allocation in message RAM
- * and returns ID of buffer, which is free.
+ * Returns put index of transmit FIFO/queue. This is the buffer hardware
+ * expects to be filled next both in FIFO and in queue mode. Index covers
+ * dedicated transmit buffers (if any) which precede FIFO/queue elements.
  *
  * @param [in] canport FDCAN block base address. See @ref fdcan_block.
  * @returns Non-negative number ID of Tx buffer which is free,
@@ -84,15 +85,128 @@ int fdcan_cccr_init_cfg(uint32_t canport, bool set, uint32_t timeout)
  */
 static int fdcan_get_free_txbuf(uint32_t canport)
 {
-	if ((FDCAN_TXBRP(canport) & FDCAN_TXBRP_TRP0) == 0) {
-		return 0;
-	} else if ((FDCAN_TXBRP(canport) & FDCAN_TXBRP_TRP1) == 0) {
-		return 1;
-	} else if ((FDCAN_TXBRP(canport) & FDCAN_TXBRP_TRP2) == 0) {
-		return 2;
+	uint32_t txfqs = FDCAN_TXFQS(canport);
+
+	if ((txfqs & FDCAN_TXFQS_TFQF) != 0) {
+		return FDCAN_E_BUSY;
+	}
+
+	return (txfqs >> FDCAN_TXFQS_TFQPI_SHIFT) & FDCAN_TXFQS_TFQPI_MASK;
+}
+
+/** Copy frame payload into message RAM.
+ *
+ * Message RAM can only be accessed in 32bit quantities, while payload
+ * buffer provided by user may be arbitrarily aligned and its length needs
+ * not be multiple of 4. Words are loaded directly if buffer is aligned,
+ * otherwise they are assembled byte by byte. Bytes past the end of
+ * payload are never read.
+ *
+ * @param [out] dst payload area of transmit buffer element
+ * @param [in] src payload data
+ * @param [in] length payload length in bytes
+ */
+static void fdcan_copy_to_ram(uint32_t *dst, const uint8_t *src, unsigned length)
+{
+	unsigned q = 0;
+
+	if (((uintptr_t) src & 3) == 0) {
+		for (; q + 4 <= length; q += 4) {
+			*dst++ = *((const uint32_t *) &src[q]);
+		}
+	}
+
+	for (; q < length; q += 4) {
+		uint32_t word = 0;
+
+		for (unsigned b = 0; b < 4 && q + b < length; ++b) {
+			word |= (uint32_t) src[q + b] << (8 * b);
+		}
+		*dst++ = word;
+	}
+}
+
+/** Copy frame payload out of message RAM.
+ *
+ * Counterpart of @ref fdcan_copy_to_ram. Exactly length bytes are written
+ * into destination buffer.
+ *
+ * @param [out] dst payload buffer
+ * @param [in] src payload area of receive FIFO element
+ * @param [in] length payload length in bytes
+ */
+static void fdcan_copy_from_ram(uint8_t *dst, const uint32_t *src, unsigned length)
+{
+	unsigned q = 0;
+
+	if (((uintptr_t) dst & 3) == 0) {
+		for (; q + 4 <= length; q += 4) {
+			*((uint32_t *) &dst[q]) = *src++;
+		}
+	}
+
+	for (; q < length; q += 4) {
+		uint32_t word = *src++;
+
+		for (unsigned b = 0; b < 4 && q + b < length; ++b) {
+			dst[q + b] = word >> (8 * b);
+		}
+	}
+}
+
+/** Fill transmit buffer element with frame.
+ *
+ * @param [out] tx_buffer transmit buffer element in message RAM
+ * @param [in] id Message ID
+ * @param [in] ext Extended message ID
+ * @param [in] rtr Request transmit
+ * @param [in] fdcan_fmt Use FDCAN format
+ * @param [in] btr_switch Switch bitrate for data portion of frame
+ * @param [in] length Message payload length. Must be valid CAN or FDCAN frame length
+ * @param [in] data Message payload data
+ * @returns Operation error status. See @ref fdcan_error.
+ */
+static int fdcan_fill_txbuf(struct fdcan_tx_buffer_element *tx_buffer,
+		uint32_t id, bool ext, bool rtr, bool fdcan_fmt, bool btr_switch,
+		uint8_t length, const uint8_t *data)
+{
+	uint32_t dlc, flags = 0;
+
+	/* Early check: if FDCAN message lentgh is > 8, it must be
+	 * a multiple of 4 *and* fdcan format must be enabled.
+	 */
+	dlc = fdcan_length_to_dlc(length);
+
+	if (dlc == 0xFF) {
+		return FDCAN_E_INVALID;
+	}
+
+	if (ext) {
+		tx_buffer->identifier_flags = FDCAN_FIFO_XTD
+			| ((id & FDCAN_FIFO_EID_MASK) << FDCAN_FIFO_EID_SHIFT);
+	} else {
+		tx_buffer->identifier_flags =
+			(id & FDCAN_FIFO_SID_MASK) << FDCAN_FIFO_SID_SHIFT;
+	}
+
+	if (rtr) {
+		tx_buffer->identifier_flags |= FDCAN_FIFO_RTR;
+	}
+
+	if (fdcan_fmt) {
+		flags |= FDCAN_FIFO_FDF;
+	}
+
+	if (btr_switch) {
+		flags |= FDCAN_FIFO_BRS;
 	}
 
-	return FDCAN_E_BUSY;
+	tx_buffer->evt_fmt_dlc_res =
+		(dlc << FDCAN_FIFO_DLC_SHIFT) | flags;
+
+	fdcan_copy_to_ram(tx_buffer->data, data, length);
+
+	return FDCAN_E_OK;
 }
 
 /** Returns fill state and next available get index from receive FIFO.
@@ -229,6 +343,245 @@ uint8_t fdcan_dlc_to_length(uint32_t dlc)
 	}
 }
 
+/** Maximum amount of distinct ranges handled by filter planner at once.
+ * If there are more, closest ranges are merged as they are added.
+ */
+#define FDCAN_FILTER_PLAN_MAX			128
+
+/** Working set of filter planner. */
+struct fdcan_filter_work {
+	/** Sorted, non-overlapping and non-adjacent ranges, inclusive */
+	uint32_t first[FDCAN_FILTER_PLAN_MAX];
+	uint32_t last[FDCAN_FILTER_PLAN_MAX];
+	unsigned count;
+	bool widened;
+};
+
+/** Merge range with its successor in filter planner working set.
+ *
+ * @param [in] work working set
+ * @param [in] idx index of range to be merged with next one
+ */
+static void fdcan_filter_merge(struct fdcan_filter_work *work, unsigned idx)
+{
+	if (work->last[idx] + 1 < work->first[idx + 1]) {
+		work->widened = true;
+	}
+
+	if (work->last[idx + 1] > work->last[idx]) {
+		work->last[idx] = work->last[idx + 1];
+	}
+
+	for (unsigned q = idx + 1; q + 1 < work->count; ++q) {
+		work->first[q] = work->first[q + 1];
+		work->last[q] = work->last[q + 1];
+	}
+	work->count--;
+}
+
+/** Merge two neighbour ranges which are closest to each other.
+ *
+ * If saving is requested, only merges which save a filter element are
+ * considered, unless there are none. Joining two single IDs never saves an
+ * element as they already share a dual ID filter, joining single ID with
+ * a range only does if there is odd amount of single IDs.
+ *
+ * @param [in] work working set, must contain at least two ranges
+ * @param [in] saving prefer merges which reduce amount of filter elements
+ */
+static void fdcan_filter_merge_closest(struct fdcan_filter_work *work, bool saving)
+{
+	unsigned singles = 0;
+	unsigned best = work->count;
+
+	for (unsigned q = 0; q < work->count; ++q) {
+		if (work->first[q] == work->last[q]) {
+			singles++;
+		}
+	}
+
+	for (unsigned q = 0; q + 1 < work->count; ++q) {
+		unsigned n = (work->first[q] == work->last[q])
+			+ (work->first[q + 1] == work->last[q + 1]);
+
+		if (saving && (n == 2 || (n == 1 && (singles % 2) == 0))) {
+			continue;
+		}
+
+		if (best == work->count || work->first[q + 1] - work->last[q]
+				< work->first[best + 1] - work->last[best]) {
+			best = q;
+		}
+	}
+
+	if (best == work->count) {
+		fdcan_filter_merge_closest(work, false);
+		return;
+	}
+
+	fdcan_filter_merge(work, best);
+}
+
+/** Add range into filter planner working set.
+ *
+ * Keeps ranges sorted and merges overlapping or adjacent ones.
+ *
+ * @param [in] work working set
+ * @param [in] first first ID of range
+ * @param [in] last last ID of range
+ */
+static void fdcan_filter_add(struct fdcan_filter_work *work, uint32_t first, uint32_t last)
+{
+	unsigned idx = 0;
+
+	if (work->count == FDCAN_FILTER_PLAN_MAX) {
+		fdcan_filter_merge_closest(work, false);
+	}
+
+	while (idx < work->count && work->first[idx] < first) {
+		idx++;
+	}
+
+	for (unsigned q = work->count; q > idx; --q) {
+		work->first[q] = work->first[q - 1];
+		work->last[q] = work->last[q - 1];
+	}
+	work->first[idx] = first;
+	work->last[idx] = last;
+	work->count++;
+
+	/* Merge with predecessor and successors if they touch, the ranges
+	 * merged here are exact, so widened is not affected.
+	 */
+	if (idx > 0 && work->last[idx - 1] + 1 >= first) {
+		idx--;
+		fdcan_filter_merge(work, idx);
+	}
+
+	while (idx + 1 < work->count && work->last[idx] + 1 >= work->first[idx + 1]) {
+		fdcan_filter_merge(work, idx);
+	}
+}
+
+/** Returns amount of filter elements needed by working set.
+ *
+ * Single IDs are paired into dual ID filters, other ranges take one range
+ * filter each.
+ *
+ * @param [in] work working set
+ * @returns amount of filter elements
+ */
+static unsigned fdcan_filter_elements(const struct fdcan_filter_work *work)
+{
+	unsigned singles = 0;
+
+	for (unsigned q = 0; q < work->count; ++q) {
+		if (work->first[q] == work->last[q]) {
+			singles++;
+		}
+	}
+
+	return work->count - singles + (singles + 1) / 2;
+}
+
+/** Plan and program filters of one kind.
+ *
+ * @param [in] canport FDCAN block base address. See @ref fdcan_block.
+ * @param [in] ext plan extended ID filters if true, standard ones otherwise
+ * @param [in] nr_filters amount of filter elements available
+ * @param [in] ranges requested ranges, those of other kind are skipped
+ * @param [in] count amount of requested ranges
+ * @param [in] action filter element configuration, see @ref fdcan_sfec
+ * @param [in,out] widened set to true if ranges had to be widened
+ * @returns amount of filter elements used or FDCAN_E_INVALID or
+ * FDCAN_E_OUTOFRANGE
+ */
+static int fdcan_filter_plan_kind(uint32_t canport, bool ext, unsigned nr_filters,
+		const struct fdcan_filter_range *ranges, unsigned count, uint8_t action,
+		bool *widened)
+{
+	struct fdcan_filter_work work;
+	uint32_t max_id = ext ? FDCAN_EFID1_MASK : FDCAN_SFID1_MASK;
+	uint32_t single = 0;
+	bool have_single = false;
+	unsigned nr = 0;
+
+	work.count = 0;
+	work.widened = false;
+
+	for (unsigned q = 0; q < count; ++q) {
+		if (ranges[q].ext != ext) {
+			continue;
+		}
+
+		if (ranges[q].first > ranges[q].last || ranges[q].last > max_id) {
+			return FDCAN_E_INVALID;
+		}
+
+		fdcan_filter_add(&work, ranges[q].first, ranges[q].last);
+	}
+
+	if (work.count > 0 && nr_filters == 0) {
+		return FDCAN_E_OUTOFRANGE;
+	}
+
+	while (fdcan_filter_elements(&work) > nr_filters) {
+		fdcan_filter_merge_closest(&work, true);
+	}
+
+	for (unsigned q = 0; q < work.count; ++q) {
+		uint32_t id1 = work.first[q], id2 = work.last[q];
+		bool dual = false;
+
+		if (id1 == id2) {
+			if (!have_single) {
+				single = id1;
+				have_single = true;
+				continue;
+			}
+			id1 = single;
+			dual = true;
+			have_single = false;
+		}
+
+		if (ext) {
+			/* Plain range type is subject to XIDAM mask */
+			fdcan_set_ext_filter(canport, nr++,
+					dual ? FDCAN_EFT_DUAL : FDCAN_EFT_RANGE_NOXIDAM,
+					id1, id2, action);
+		} else {
+			fdcan_set_std_filter(canport, nr++,
+					dual ? FDCAN_SFT_DUAL : FDCAN_SFT_RANGE,
+					id1, id2, action);
+		}
+	}
+
+	if (have_single) {
+		if (ext) {
+			fdcan_set_ext_filter(canport, nr++, FDCAN_EFT_DUAL,
+					single, single, action);
+		} else {
+			fdcan_set_std_filter(canport, nr++, FDCAN_SFT_DUAL,
+					single, single, action);
+		}
+	}
+
+	for (unsigned q = nr; q < nr_filters; ++q) {
+		if (ext) {
+			fdcan_set_ext_filter(canport, q, 0, 0, 0, FDCAN_EFEC_DISABLE);
+		} else {
+			fdcan_set_std_filter(canport, q, FDCAN_SFT_DISABLE, 0, 0,
+					FDCAN_SFEC_DISABLE);
+		}
+	}
+
+	if (work.widened) {
+		*widened = true;
+	}
+
+	return nr;
+}
+
 /* --- FD-CAN functions ----------------------------------------------------- */
 
 /** @ingroup fdcan_file */
@@ -470,6 +823,57 @@ void fdcan_set_ext_filter(uint32_t canport, uint32_t nr,
 		| ((id2 & FDCAN_EFID2_MASK) << FDCAN_EFID2_SHIFT);
 }
 
+/** Plan and program filter rules
+ *
+ * Compiles list of IDs and ID ranges into as few filter rules as possible
+ * and programs them. Overlapping and adjacent ranges are joined, remaining
+ * ranges use range filter rules and single IDs are paired into dual ID
+ * filter rules. If result doesn't fit into filter rules available, ranges
+ * closest to each other are joined (accepting IDs in between) until it does.
+ * Unused rules are disabled.
+ *
+ * Filter rules must be allocated first using @ref fdcan_init_filter or
+ * @ref fdcan_set_ram_layout. Frames which don't match any rule are accepted
+ * or rejected depending on global filter configuration.
+ *
+ * @param [in] canport FDCAN block base address. See @ref fdcan_block.
+ * @param [in] std_filters amount of standard ID filter rules available
+ * @param [in] ext_filters amount of extended ID filter rules available
+ * @param [in] ranges IDs to be accepted
+ * @param [in] count amount of entries in ranges
+ * @param [in] fifo ID of FIFO accepted frames are stored into
+ * @param [out] widened set to true if ranges had to be widened, so more IDs
+ *				than requested are accepted. Optional.
+ * @returns Amount of filter rules used, FDCAN_E_INVALID if a range is invalid
+ * or FDCAN_E_OUTOFRANGE if IDs are requested for kind with no filter rules.
+ */
+int fdcan_filter_plan(uint32_t canport, unsigned std_filters, unsigned ext_filters,
+		const struct fdcan_filter_range *ranges, unsigned count, uint8_t fifo,
+		bool *widened)
+{
+	uint8_t action = fifo ? FDCAN_SFEC_FIFO1 : FDCAN_SFEC_FIFO0;
+	bool was_widened = false;
+	int std_used, ext_used;
+
+	std_used = fdcan_filter_plan_kind(canport, false, std_filters, ranges, count,
+			action, &was_widened);
+	if (std_used < 0) {
+		return std_used;
+	}
+
+	ext_used = fdcan_filter_plan_kind(canport, true, ext_filters, ranges, count,
+			action, &was_widened);
+	if (ext_used < 0) {
+		return ext_used;
+	}
+
+	if (widened) {
+		*widened = was_widened;
+	}
+
+	return std_used + ext_used;
+}
+
 /** Transmit Message using FDCAN
  *
  * @param [in] canport CAN block register base. See @ref fdcan_block.
@@ -486,8 +890,7 @@ void fdcan_set_ext_filter(uint32_t canport, uint32_t nr,
 int fdcan_transmit(uint32_t canport, uint32_t id, bool ext, bool rtr,
 			bool fdcan_fmt, bool btr_switch, uint8_t length, const uint8_t *data)
 {
-	int mailbox;
-	uint32_t dlc, flags = 0;
+	int mailbox, ret;
 
 	mailbox = fdcan_get_free_txbuf(canport);
 
@@ -497,45 +900,60 @@ int fdcan_transmit(uint32_t canport, uint32_t id, bool ext, bool rtr,
 
 	struct fdcan_tx_buffer_element *tx_buffer = fdcan_get_txbuf_addr(canport, mailbox);
 
-	/* Early check: if FDCAN message lentgh is > 8, it must be
-	 * a multiple of 4 *and* fdcan format must be enabled.
-	 */
-	dlc = fdcan_length_to_dlc(length);
+	ret = fdcan_fill_txbuf(tx_buffer, id, ext, rtr, fdcan_fmt, btr_switch,
+			length, data);
 
-	if (dlc == 0xFF) {
-		return FDCAN_E_INVALID;
+	if (ret != FDCAN_E_OK) {
+		return ret;
 	}
 
-	if (ext) {
-		tx_buffer->identifier_flags = FDCAN_FIFO_XTD
-			| ((id & FDCAN_FIFO_EID_MASK) << FDCAN_FIFO_EID_SHIFT);
-	} else {
-		tx_buffer->identifier_flags =
-			(id & FDCAN_FIFO_SID_MASK) << FDCAN_FIFO_SID_SHIFT;
-	}
+	FDCAN_TXBAR(canport) = 1 << mailbox;
 
-	if (rtr) {
-		tx_buffer->identifier_flags |= FDCAN_FIFO_RTR;
-	}
+	return mailbox;
+}
 
-	if (fdcan_fmt) {
-		flags |= FDCAN_FIFO_FDF;
-	}
+/** Transmit multiple messages using FDCAN
+ *
+ * Queues as many frames as there are free elements in transmit FIFO/queue.
+ * In FIFO mode frames are transmitted in the order given, in queue mode they
+ * are transmitted by priority of their IDs. Mode is selected using
+ * tx_queue_mode argument of @ref fdcan_set_can.
+ *
+ * @param [in] canport CAN block register base. See @ref fdcan_block.
+ * @param [in] frames Frames to be transmitted
+ * @param [in] count Amount of frames in frames array
+ * @returns Amount of frames queued, which may be less than count if transmit
+ * FIFO/queue got full. If first frame has invalid length, FDCAN_E_INVALID is
+ * returned. Queueing stops at first frame having invalid length.
+ */
+int fdcan_transmit_batch(uint32_t canport, const struct fdcan_frame *frames,
+		unsigned count)
+{
+	unsigned n;
+	int mailbox;
+	uintptr_t txbuf_base = (uintptr_t) fdcan_get_txbuf_addr(canport, 0);
+	unsigned txbuf_size = fdcan_get_txbuf_element_size(canport);
 
-	if (btr_switch) {
-		flags |= FDCAN_FIFO_BRS;
-	}
+	for (n = 0; n < count; ++n) {
+		const struct fdcan_frame *frame = &frames[n];
 
-	tx_buffer->evt_fmt_dlc_res =
-		(dlc << FDCAN_FIFO_DLC_SHIFT) | flags;
+		mailbox = fdcan_get_free_txbuf(canport);
+		if (mailbox == FDCAN_E_BUSY) {
+			break;
+		}
 
-	for (int q = 0; q < length; q += 4) {
-		tx_buffer->data[q / 4] = *((uint32_t *) &data[q]);
-	}
+		if (fdcan_fill_txbuf((struct fdcan_tx_buffer_element *)
+				(txbuf_base + mailbox * txbuf_size),
+				frame->id, frame->ext, frame->rtr, frame->fdf,
+				frame->brs, frame->length, frame->data) != FDCAN_E_OK) {
+			return (n == 0) ? FDCAN_E_INVALID : (int) n;
+		}
 
-	FDCAN_TXBAR(canport) |= 1 << mailbox;
+		/* Put index moves on as soon as add request is set */
+		FDCAN_TXBAR(canport) = 1 << mailbox;
+	}
 
-	return mailbox;
+	return n;
 }
 
 /** Receive Message from FDCAN FIFO
@@ -604,9 +1022,7 @@ int fdcan_receive(uint32_t canport, uint8_t fifo_id, bool release, uint32_t *id,
 		*rtr = ((fifo->identifier_flags & FDCAN_FIFO_RTR) == FDCAN_FIFO_RTR);
 	}
 
-	for (unsigned int q = 0; q < len; q += 4) {
-		*((uint32_t *) &data[q]) = fifo->data[q / 4];
-	}
+	fdcan_copy_from_ram(data, fifo->data, len);
 
 	if (release) {
 		FDCAN_RXFIA(canport, fifo_id) = get_index << FDCAN_RXFIFO_AI_SHIFT;
@@ -615,6 +1031,81 @@ int fdcan_receive(uint32_t canport, uint8_t fifo_id, bool release, uint32_t *id,
 	return FDCAN_E_OK;
 }
 
+/** Receive all pending messages from FDCAN FIFO
+ *
+ * Reads up to max messages from receive FIFO and releases all of them using
+ * single acknowledge. This is way cheaper than calling @ref fdcan_receive
+ * for each message if FIFO is drained from interrupt handler.
+ *
+ * @param [in] canport FDCAN block base address. See @ref fdcan_block
+ * @param [in] fifo_id FIFO id.
+ * @param [out] frames Buffer for received frames
+ * @param [in] max Amount of frames which fit into frames buffer
+ * @returns Amount of frames read, 0 if FIFO was empty.
+ */
+int fdcan_receive_batch(uint32_t canport, uint8_t fifo_id, struct fdcan_frame *frames,
+		unsigned max)
+{
+	unsigned pending_frames, get_index, last_index, depth, dlc;
+	uintptr_t fifo_base;
+	unsigned element_size;
+
+	fdcan_get_fill_rxfifo(canport, fifo_id, &get_index, &pending_frames);
+
+	if (pending_frames > max) {
+		pending_frames = max;
+	}
+
+	if (pending_frames == 0) {
+		return 0;
+	}
+
+	fifo_base = (uintptr_t) fdcan_get_rxfifo_addr(canport, fifo_id, 0);
+	element_size = fdcan_get_fifo_element_size(canport, fifo_id);
+	depth = fdcan_get_fifo_depth(canport, fifo_id);
+	last_index = get_index;
+
+	for (unsigned n = 0; n < pending_frames; ++n) {
+		const struct fdcan_rx_fifo_element *fifo =
+			(const struct fdcan_rx_fifo_element *)
+			(fifo_base + get_index * element_size);
+		struct fdcan_frame *frame = &frames[n];
+		uint32_t identifier_flags = fifo->identifier_flags;
+		uint32_t filt_fmt_dlc_ts = fifo->filt_fmt_dlc_ts;
+
+		frame->ext = (identifier_flags & FDCAN_FIFO_XTD) == FDCAN_FIFO_XTD;
+		if (frame->ext) {
+			frame->id = (identifier_flags >> FDCAN_FIFO_EID_SHIFT)
+				& FDCAN_FIFO_EID_MASK;
+		} else {
+			frame->id = (identifier_flags >> FDCAN_FIFO_SID_SHIFT)
+				& FDCAN_FIFO_SID_MASK;
+		}
+		frame->rtr = (identifier_flags & FDCAN_FIFO_RTR) == FDCAN_FIFO_RTR;
+		frame->fdf = (filt_fmt_dlc_ts & FDCAN_FIFO_FDF) == FDCAN_FIFO_FDF;
+		frame->brs = (filt_fmt_dlc_ts & FDCAN_FIFO_BRS) == FDCAN_FIFO_BRS;
+		frame->fmi = (filt_fmt_dlc_ts >> FDCAN_FIFO_MM_SHIFT)
+			& FDCAN_FIFO_MM_MASK;
+		frame->timestamp = (filt_fmt_dlc_ts >> FDCAN_FIFO_RXTS_SHIFT)
+			& FDCAN_FIFO_RXTS_MASK;
+
+		dlc = (filt_fmt_dlc_ts >> FDCAN_FIFO_DLC_SHIFT) & FDCAN_FIFO_DLC_MASK;
+		frame->length = fdcan_dlc_to_length(dlc);
+
+		fdcan_copy_from_ram(frame->data, fifo->data, frame->length);
+
+		last_index = get_index;
+		if (++get_index == depth) {
+			get_index = 0;
+		}
+	}
+
+	/* Acknowledging last element read releases all elements before it */
+	FDCAN_RXFIA(canport, fifo_id) = last_index << FDCAN_RXFIFO_AI_SHIFT;
+
+	return pending_frames;
+}
+
 /** Release receive oldest FIFO entry.
  *
  * This function will mask oldest entry in FIFO as released making
@@ -0,0 +1,341 @@
+/** @addtogroup flash_file
+ *
+ * Background update of a dual bank flash.
+ *
+ * On dual bank parts one bank can be erased and programmed while the CPU keeps
+ * executing from the other one. The inactive bank is always seen at the second
+ * half of the flash address space, whichever physical bank it is, so images
+ * are linked for 0x08000000 as usual. The new image is written with
+ * flash_update_write(), checked with the hardware CRC unit and the device is
+ * switched to it with a single option byte change by flash_update_swap(). A
+ * power failure before the option bytes are written leaves the running image
+ * in place.
+ *
+ * The application unlocks the flash and enables the SYSCFG and CRC clocks
+ * before starting an update. Supported on F42x/F43x/F469/F479 (2MB, or 1MB
+ * with DB1M set), L47x/L48x, 1MB L49x/L4Ax or smaller ones with DUALBANK set,
+ * L4R/L4S with DBANK set and G47x/G48x with DBANK set.
+ *
+ * Example:
+ * @code
+ *	struct flash_update up;
+ *
+ *	if (flash_update_start(&up)) {
+ *		while (flash_update_busy(&up)) {
+ *			do_work();
+ *		}
+ *		while ((n = receive_chunk(buf, sizeof(buf))) > 0) {
+ *			flash_update_write(&up, buf, n);
+ *		}
+ *		if (flash_update_verify(&up, image_len, image_crc32)) {
+ *			flash_update_swap(&up);
+ *		}
+ *	}
+ * @endcode
+ */
+
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@{*/
+
+#include <libopencm3/cm3/scb.h>
+#include <libopencm3/stm32/crc.h>
+#include <libopencm3/stm32/dbgmcu.h>
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/syscfg.h>
+#include <libopencm3/stm32/common/flash_common_idcache.h>
+
+#if defined(FLASH_OPTCR_BFB2)
+
+#define FLASH_UPDATE_ERASE	(FLASH_CR_MER | FLASH_CR_MER1)
+#define FLASH_UPDATE_ERRORS	(FLASH_SR_PGSERR | FLASH_SR_PGPERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR)
+
+static bool flash_update_dualbank(uint32_t size_kb)
+{
+	return size_kb == 2048 ||
+	       (size_kb == 1024 && (FLASH_OPTCR & FLASH_OPTCR_DB1M));
+}
+
+static bool flash_update_bank2_mapped(void)
+{
+	return SYSCFG_MEMRM & SYSCFG_MEMRM_UFB_MODE;
+}
+
+static void flash_update_erase(uint8_t bank)
+{
+	FLASH_CR &= ~(FLASH_CR_PROGRAM_MASK << FLASH_CR_PROGRAM_SHIFT);
+	FLASH_CR |= flash_get_program_parallelism() << FLASH_CR_PROGRAM_SHIFT;
+	FLASH_CR |= (bank == 2) ? FLASH_CR_MER1 : FLASH_CR_MER;
+	FLASH_CR |= FLASH_CR_STRT;
+}
+
+static uint32_t flash_update_program(uint32_t address, const uint8_t *data,
+				     uint32_t len)
+{
+	flash_program(address, data, len);
+	return len;
+}
+
+static void flash_update_set_boot_bank(uint8_t bank)
+{
+	uint32_t optcr = FLASH_OPTCR & ~FLASH_OPTCR_BFB2;
+
+	if (bank == 2) {
+		optcr |= FLASH_OPTCR_BFB2;
+	}
+	flash_program_option_bytes(optcr);
+}
+
+#else
+
+#define FLASH_UPDATE_ERASE	(FLASH_CR_MER1 | FLASH_CR_MER2)
+#define FLASH_UPDATE_DEV_ID_L47X	0x415
+#define FLASH_UPDATE_ERRORS	(FLASH_SR_FASTERR | FLASH_SR_MISERR | \
+				 FLASH_SR_PGSERR | FLASH_SR_SIZERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR | \
+				 FLASH_SR_PROGERR)
+
+static bool flash_update_dualbank(uint32_t size_kb)
+{
+#if defined(FLASH_BANK2_BASE)
+	(void)size_kb;
+	return FLASH_OPTR & FLASH_OPTR_DBANK;
+#else
+	/* L47x/L48x are always dual bank, DUALBANK is reserved there */
+	if ((DBGMCU_IDCODE & DBGMCU_IDCODE_DEV_ID_MASK) ==
+	    FLASH_UPDATE_DEV_ID_L47X) {
+		return true;
+	}
+	/* 1MB L49x/L4Ax are always dual bank */
+	if (size_kb == 2048) {
+		return FLASH_OPTR & FLASH_OPTR_DBANK;
+	}
+	return size_kb == 1024 || (FLASH_OPTR & FLASH_OPTR_DUALBANK);
+#endif
+}
+
+static bool flash_update_bank2_mapped(void)
+{
+	return SYSCFG_MEMRMP & SYSCFG_MEMRMP_FB_MODE;
+}
+
+static void flash_update_erase(uint8_t bank)
+{
+	FLASH_CR |= (bank == 2) ? FLASH_CR_MER2 : FLASH_CR_MER1;
+	FLASH_CR |= FLASH_CR_START;
+}
+
+/* Programs double words, the last one padded with 0xff */
+static uint32_t flash_update_program(uint32_t address, const uint8_t *data,
+				     uint32_t len)
+{
+	uint32_t done;
+
+#if defined(FLASH_ROW_SIZE)
+	/* The bank is mass erased, whole rows are fast programmed. */
+	flash_program(address, (uint8_t *)data, len);
+	done = (len + 7) & ~7;
+#else
+	for (done = 0; done < len; done += 8) {
+		uint64_t dw = 0;
+		int i;
+
+		for (i = 7; i >= 0; i--) {
+			dw <<= 8;
+			dw |= (done + i < len) ? data[done + i] : 0xff;
+		}
+		flash_program_double_word(address + done, dw);
+		if (FLASH_SR & FLASH_UPDATE_ERRORS) {
+			break;
+		}
+	}
+#endif
+	return done;
+}
+
+static void flash_update_set_boot_bank(uint8_t bank)
+{
+	uint32_t optr = FLASH_OPTR & ~FLASH_OPTR_BFB2;
+
+	if (bank == 2) {
+		optr |= FLASH_OPTR_BFB2;
+	}
+	flash_program_option_bytes(optr);
+	/* Reloads the option bytes, which resets the device. */
+	FLASH_CR |= FLASH_CR_OBL_LAUNCH;
+}
+
+#endif
+
+static uint32_t flash_update_size_kb(void)
+{
+	return MMIO16(DESIG_FLASH_SIZE_BASE);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief Check for dual bank operation
+
+@returns true if the flash is organised as two banks
+*/
+
+bool flash_dualbank_enabled(void)
+{
+	return flash_update_dualbank(flash_update_size_kb());
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief Get the Bank executed from
+
+@returns physical bank mapped at 0x08000000, 1 or 2
+*/
+
+uint8_t flash_bank_active(void)
+{
+	return flash_update_bank2_mapped() ? 2 : 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief Start an Update of the inactive Bank
+
+Starts the erase of the inactive bank and returns without waiting for it, see
+flash_update_busy().
+
+@param[out] update update state, caller owned
+@returns false if the flash isn't dual bank
+*/
+
+bool flash_update_start(struct flash_update *update)
+{
+	uint32_t size_kb = flash_update_size_kb();
+
+	if (!flash_update_dualbank(size_kb)) {
+		return false;
+	}
+
+	update->size = size_kb * 1024 / 2;
+#if defined(FLASH_BANK2_BASE)
+	update->address = FLASH_BANK2_BASE;
+#else
+	update->address = FLASH_BASE + update->size;
+#endif
+	update->written = 0;
+	update->bank = (flash_bank_active() == 1) ? 2 : 1;
+
+	flash_wait_for_last_operation();
+	FLASH_SR = FLASH_UPDATE_ERRORS;
+	flash_update_erase(update->bank);
+	update->erasing = true;
+	return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief Check for a running Operation on the inactive Bank
+
+@param[in] update update state
+@returns true while the bank erase or programming is in progress
+*/
+
+bool flash_update_busy(struct flash_update *update)
+{
+	if (FLASH_SR & FLASH_SR_BSY) {
+		return true;
+	}
+	if (update->erasing) {
+		FLASH_CR &= ~FLASH_UPDATE_ERASE;
+		update->erasing = false;
+	}
+	return false;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief Append Data to the new Image
+
+Waits for the bank erase to complete. On L4 and G4 all but the last block must
+be a multiple of 8 bytes long.
+
+@param[in] update update state
+@param[in] data image data, any alignment
+@param[in] len number of bytes
+@returns false on a programming error or if the image doesn't fit the bank
+*/
+
+bool flash_update_write(struct flash_update *update, const uint8_t *data,
+			uint32_t len)
+{
+	if (len > update->size - update->written) {
+		return false;
+	}
+	while (flash_update_busy(update));
+
+	update->written += flash_update_program(update->address +
+						update->written, data, len);
+	return !(FLASH_SR & FLASH_UPDATE_ERRORS);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief Verify the new Image
+
+Calculates the CRC-32 (as used by zlib) of the start of the inactive bank with
+the hardware CRC unit.
+
+@param[in] update update state
+@param[in] len image length in bytes
+@param[in] crc expected CRC-32 of the image
+@returns true if the image matches
+*/
+
+bool flash_update_verify(struct flash_update *update, uint32_t len,
+			 uint32_t crc)
+{
+	uint32_t acr = FLASH_ACR;
+
+	if (len > update->written) {
+		return false;
+	}
+	while (flash_update_busy(update));
+
+	/* Drop data cached before the bank was erased. */
+	if (acr & FLASH_ACR_DCEN) {
+		FLASH_ACR = acr & ~FLASH_ACR_DCEN;
+		FLASH_ACR |= FLASH_ACR_DCRST;
+		FLASH_ACR = acr;
+	}
+
+	return crc_compute(&crc_preset_crc32, (const void *)update->address,
+			   len) == crc;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief Boot the new Image
+
+Selects the updated bank as boot bank in the option bytes and resets the
+device.
+
+@param[in] update update state
+*/
+
+void flash_update_swap(struct flash_update *update)
+{
+	while (flash_update_busy(update));
+
+	flash_update_set_boot_bank(update->bank);
+	scb_reset_system();
+}
+
+/**@}*/
@@ -1,5 +1,23 @@
 /** @addtogroup flash_file
  *
+ * Instruction fetches from the flash stall while it is erased or programmed,
+ * a sector erase takes up to a few seconds. When the library is built with
+ * -DLIBOPENCM3_FLASH_RAMFUNC (make CFLAGS=-DLIBOPENCM3_FLASH_RAMFUNC), the
+ * erase and program functions run from RAM. Interrupts that must be served
+ * meanwhile need the vector table and their handlers in RAM as well:
+ *
+ * @code
+ *	static vector_table_t ram_vectors __attribute__((aligned(512)));
+ *
+ *	LIBOPENCM3_RAMFUNC void tim1_up_tim10_isr(void)
+ *	{
+ *		...
+ *	}
+ *
+ *	memcpy(&ram_vectors, &vector_table, sizeof(ram_vectors));
+ *	SCB_VTOR = (uint32_t)&ram_vectors;
+ *	flash_erase_sector(5, FLASH_CR_PROGRAM_X32);
+ * @endcode
  */
 
 /*
@@ -25,6 +43,22 @@
 /**@{*/
 
 #include <libopencm3/stm32/flash.h>
+#include "flash_common_load.h"
+
+/* Widest program size allowed by the supply, used by flash_program(). */
+static uint32_t flash_program_psize = FLASH_CR_PROGRAM_X8;
+
+/* The programming sequence error flag is called ERSERR on F7. */
+#if defined(FLASH_SR_PGSERR)
+#define FLASH_SR_PROGRAM_ERRORS	(FLASH_SR_PGSERR | FLASH_SR_PGPERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR)
+#elif defined(FLASH_SR_ERSERR)
+#define FLASH_SR_PROGRAM_ERRORS	(FLASH_SR_ERSERR | FLASH_SR_PGPERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR)
+#else
+#define FLASH_SR_PROGRAM_ERRORS	(FLASH_SR_PGPERR | FLASH_SR_PGAERR | \
+				 FLASH_SR_WRPERR)
+#endif
 
 /*---------------------------------------------------------------------------*/
 /** @brief Set the Program Parallelism Size
@@ -35,7 +69,7 @@ programming manual for more information.
 @param[in] psize The programming word width one of: @ref flash_cr_program_width
 */
 
-static inline void flash_set_program_size(uint32_t psize)
+static inline FLASH_RAMFUNC void flash_set_program_size(uint32_t psize)
 {
 	FLASH_CR &= ~(FLASH_CR_PROGRAM_MASK << FLASH_CR_PROGRAM_SHIFT);
 	FLASH_CR |= psize << FLASH_CR_PROGRAM_SHIFT;
@@ -91,7 +125,7 @@ was not properly erased.
 @param[in] data Double word to write
 */
 
-void flash_program_double_word(uint32_t address, uint64_t data)
+FLASH_RAMFUNC void flash_program_double_word(uint32_t address, uint64_t data)
 {
 	/* Ensure that all flash operations are complete. */
 	flash_wait_for_last_operation();
@@ -121,7 +155,7 @@ was not properly erased.
 @param[in] data word to write
 */
 
-void flash_program_word(uint32_t address, uint32_t data)
+FLASH_RAMFUNC void flash_program_word(uint32_t address, uint32_t data)
 {
 	/* Ensure that all flash operations are complete. */
 	flash_wait_for_last_operation();
@@ -151,7 +185,7 @@ was not properly erased.
 @param[in] data half word to write
 */
 
-void flash_program_half_word(uint32_t address, uint16_t data)
+FLASH_RAMFUNC void flash_program_half_word(uint32_t address, uint16_t data)
 {
 	flash_wait_for_last_operation();
 	flash_set_program_size(FLASH_CR_PROGRAM_X16);
@@ -176,7 +210,7 @@ was not properly erased.
 @param[in] data byte to write
 */
 
-void flash_program_byte(uint32_t address, uint8_t data)
+FLASH_RAMFUNC void flash_program_byte(uint32_t address, uint8_t data)
 {
 	flash_wait_for_last_operation();
 	flash_set_program_size(FLASH_CR_PROGRAM_X8);
@@ -190,26 +224,108 @@ void flash_program_byte(uint32_t address, uint8_t data)
 	FLASH_CR &= ~FLASH_CR_PG;		/* Disable the PG bit. */
 }
 
+/*---------------------------------------------------------------------------*/
+/** @brief Set the Program Parallelism used for Data Blocks
+
+Sets the widest program size flash_program() may use. It depends on the supply
+voltage range, see the programming manual: x8 from 1.8V, x16 from 2.1V, x32
+from 2.7V (2.4V on some parts) and x64 only with the external VPP supply.
+The default is x8.
+
+@param[in] program_size The programming word width one of:
+@ref flash_cr_program_width
+*/
+
+void flash_set_program_parallelism(uint32_t program_size)
+{
+	flash_program_psize = program_size & FLASH_CR_PROGRAM_MASK;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief Get the Program Parallelism used for Data Blocks
+
+@returns The programming word width one of: @ref flash_cr_program_width
+*/
+
+uint32_t flash_get_program_parallelism(void)
+{
+	return flash_program_psize;
+}
+
 /*---------------------------------------------------------------------------*/
 /** @brief Program a Data Block to FLASH
 
-This programs an arbitrary length data block to FLASH memory.
-The program error flag should be checked separately for the event that memory
-was not properly erased.
+This programs an arbitrary length data block to FLASH memory. The bulk of the
+block is programmed with the width set by flash_set_program_parallelism(), the
+unaligned bytes at both ends a byte at a time. Pending programming errors are
+cleared first, and programming stops at the first new one, which is left set in
+the status register. The program error flag should be checked separately for
+the event that memory was not properly erased.
 
 @param[in] address Starting address in Flash.
 @param[in] data Pointer to start of data block.
 @param[in] len Length of data block.
 */
 
-void flash_program(uint32_t address, const uint8_t *data, uint32_t len)
+FLASH_RAMFUNC void flash_program(uint32_t address, const uint8_t *data, uint32_t len)
 {
-	/* TODO: Use dword and word size program operations where possible for
-	 * turbo speed.
-	 */
-	uint32_t i;
-	for (i = 0; i < len; i++) {
-		flash_program_byte(address+i, data[i]);
+	uint32_t width = 1 << flash_program_psize;
+	uint32_t head = (width - (address & (width - 1))) & (width - 1);
+	uint32_t body;
+
+	if (head > len) {
+		head = len;
+	}
+	body = (len - head) & ~(width - 1);
+
+	/* Stale flags would fail the next programming or fake a failure. */
+	flash_wait_for_last_operation();
+	FLASH_SR = FLASH_SR_PROGRAM_ERRORS;
+
+	for (; head; head--, len--) {
+		flash_program_byte(address++, *data++);
+		if (FLASH_SR & FLASH_SR_PROGRAM_ERRORS) {
+			return;
+		}
+	}
+
+	if (body) {
+		flash_wait_for_last_operation();
+		flash_set_program_size(flash_program_psize);
+		FLASH_CR |= FLASH_CR_PG;
+
+		for (; body; body -= width, len -= width) {
+			switch (width) {
+			case 8:
+				MMIO64(address) = flash_load_double_word(data);
+				break;
+			case 4:
+				MMIO32(address) = flash_load_word(data);
+				break;
+			case 2:
+				MMIO16(address) = data[0] | (data[1] << 8);
+				break;
+			default:
+				MMIO8(address) = *data;
+				break;
+			}
+			address += width;
+			data += width;
+			flash_wait_for_last_operation();
+			if (FLASH_SR & FLASH_SR_PROGRAM_ERRORS) {
+				FLASH_CR &= ~FLASH_CR_PG;
+				return;
+			}
+		}
+
+		FLASH_CR &= ~FLASH_CR_PG;
+	}
+
+	while (len--) {
+		flash_program_byte(address++, *data++);
+		if (FLASH_SR & FLASH_SR_PROGRAM_ERRORS) {
+			return;
+		}
 	}
 }
 
@@ -226,7 +342,7 @@ See the reference manual or the FLASH programming manual for details.
 @param program_size: 0 (8-bit), 1 (16-bit), 2 (32-bit), 3 (64-bit)
 */
 
-void flash_erase_sector(uint8_t sector, uint32_t program_size)
+FLASH_RAMFUNC void flash_erase_sector(uint8_t sector, uint32_t program_size)
 {
 	flash_wait_for_last_operation();
 	flash_set_program_size(program_size);
@@ -255,7 +371,7 @@ memory.
 @param program_size: 0 (8-bit), 1 (16-bit), 2 (32-bit), 3 (64-bit)
 */
 
-void flash_erase_all_sectors(uint32_t program_size)
+FLASH_RAMFUNC void flash_erase_all_sectors(uint32_t program_size)
 {
 	flash_wait_for_last_operation();
 	flash_set_program_size(program_size);
@@ -55,5 +55,25 @@ void flash_icache_reset(void)
 	FLASH_ACR |= FLASH_ACR_ICRST;
 }
 
+void flash_set_cache_policy(uint32_t ws, uint32_t policy)
+{
+	uint32_t reg32 = FLASH_ACR & ~(FLASH_ACR_ICEN | FLASH_ACR_DCEN);
+
+	FLASH_ACR = reg32;
+	FLASH_ACR = reg32 | FLASH_ACR_ICRST | FLASH_ACR_DCRST;
+
+	reg32 &= ~(FLASH_ACR_PRFTEN |
+		   (FLASH_ACR_LATENCY_MASK << FLASH_ACR_LATENCY_SHIFT));
+	reg32 |= (ws & FLASH_ACR_LATENCY_MASK) << FLASH_ACR_LATENCY_SHIFT;
+	reg32 |= policy & FLASH_ACR_PRFTEN;
+	FLASH_ACR = reg32;
+
+	/* The new latency is in use once it reads back. */
+	while (((FLASH_ACR >> FLASH_ACR_LATENCY_SHIFT) &
+		FLASH_ACR_LATENCY_MASK) != (ws & FLASH_ACR_LATENCY_MASK));
+
+	FLASH_ACR = reg32 | (policy & (FLASH_ACR_ICEN | FLASH_ACR_DCEN));
+}
+
 /**@}*/
 
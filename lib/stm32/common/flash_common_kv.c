@@ -0,0 +1,588 @@
+/** @addtogroup flash_file
+ *
+ * Key-value store on internal flash.
+ *
+ * Values are appended to a log in one of two or more flash areas (pages or
+ * sectors), a caller owned hash table maps keys to their latest record so
+ * lookups don't scan the flash. When the active area is full, the records in
+ * use are copied to the next area, which then becomes the active one; the old
+ * area is erased later by flash_kv_poll(), so writes don't wait for erasures
+ * and the areas are worn evenly.
+ *
+ * Each record carries a check value and is written before it is used, the
+ * header of an area is only written once all records have been copied to it,
+ * so a power failure loses at most the write in progress.
+ *
+ * On G0/G4/L4 a double word cut by a power failure can fail its ECC check,
+ * reading it then raises an NMI. The store treats such records like any
+ * other cut record, but the application's nmi_handler() has to call
+ * flash_kv_nmi_handler(), which clears the error.
+ *
+ * The application unlocks the flash before using the store and calls
+ * flash_kv_poll() when idle. On F2/F4/F7 the program size set with
+ * flash_set_program_parallelism() is used.
+ *
+ * Example:
+ * @code
+ *	static const struct flash_kv_area areas[] = {
+ *		{ .address = 0x08008000, .size = 16384, .erase_id = 2 },
+ *		{ .address = 0x0800c000, .size = 16384, .erase_id = 3 },
+ *	};
+ *	static struct flash_kv_entry index[64];
+ *	static struct flash_kv kv;
+ *
+ *	void nmi_handler(void)
+ *	{
+ *		flash_kv_nmi_handler();
+ *	}
+ *
+ *	flash_unlock();
+ *	flash_kv_init(&kv, areas, 2, index, 64);
+ *	flash_kv_write(&kv, KEY_BAUDRATE, &baud, sizeof(baud));
+ *	flash_kv_read(&kv, KEY_BAUDRATE, &baud, sizeof(baud));
+ * @endcode
+ */
+
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@{*/
+
+#include <libopencm3/stm32/flash.h>
+
+/* Area header: magic and sequence number. Record: key, length (top bit set
+ * for a deletion), check value and the value padded to 8 bytes, the double
+ * word programming unit of G0/G4/L4. */
+#define FLASH_KV_MAGIC		0x3153564b
+#define FLASH_KV_HDR_SIZE	8
+#define FLASH_KV_DELETED	0x8000
+#define FLASH_KV_ERASED		0xffffffff
+
+#if defined(FLASH_CR_SNB_SHIFT)
+
+/* The programming sequence error flag is called ERSERR on F7. */
+#if defined(FLASH_SR_PGSERR)
+#define FLASH_KV_SR_ERRORS	(FLASH_SR_PGSERR | FLASH_SR_PGPERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR)
+#else
+#define FLASH_KV_SR_ERRORS	(FLASH_SR_ERSERR | FLASH_SR_PGPERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR)
+#endif
+
+static void flash_kv_erase(const struct flash_kv_area *area)
+{
+	flash_erase_sector(area->erase_id, flash_get_program_parallelism());
+}
+
+static void flash_kv_write_flash(uint32_t address, const uint8_t *data,
+				 uint32_t len)
+{
+	flash_program(address, data, len);
+}
+
+#elif defined(FLASH_CR_PNB_SHIFT)
+
+#define FLASH_KV_SR_ERRORS	(FLASH_SR_FASTERR | FLASH_SR_MISERR | \
+				 FLASH_SR_PGSERR | FLASH_SR_SIZERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR | \
+				 FLASH_SR_PROGERR | FLASH_SR_OPERR)
+
+static void flash_kv_erase(const struct flash_kv_area *area)
+{
+	flash_erase_page(area->erase_id);
+}
+
+static void flash_kv_write_flash(uint32_t address, const uint8_t *data,
+				 uint32_t len)
+{
+	flash_program(address, (uint8_t *)data, len);
+}
+
+#else
+
+#define FLASH_KV_SR_ERRORS	(FLASH_SR_PGERR | FLASH_SR_WRPRTERR)
+
+static void flash_kv_erase(const struct flash_kv_area *area)
+{
+	flash_erase_page(area->address);
+}
+
+static void flash_kv_write_flash(uint32_t address, const uint8_t *data,
+				 uint32_t len)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i += 2) {
+		flash_program_half_word(address + i,
+					data[i] | (data[i + 1] << 8));
+	}
+}
+
+#endif
+
+#if defined(FLASH_ECCR_ECCD)
+
+static volatile bool flash_kv_ecc_error;
+
+/* True if flash reads returned uncorrectable data since the last call. */
+static bool flash_kv_ecc_failed(void)
+{
+	bool failed = flash_kv_ecc_error;
+
+	if (FLASH_ECCR & FLASH_ECCR_ECCD) {
+		FLASH_ECCR |= FLASH_ECCR_ECCD;
+		failed = true;
+	}
+	flash_kv_ecc_error = false;
+	return failed;
+}
+
+#else
+
+static bool flash_kv_ecc_failed(void)
+{
+	return false;
+}
+
+#endif
+
+/* Program and check for errors, e.g. locked or not erased flash. */
+static bool flash_kv_program(uint32_t address, const uint8_t *data,
+			     uint32_t len)
+{
+	FLASH_SR = FLASH_KV_SR_ERRORS;
+	flash_kv_write_flash(address, data, len);
+	if (FLASH_SR & FLASH_KV_SR_ERRORS) {
+		FLASH_SR = FLASH_KV_SR_ERRORS;
+		return false;
+	}
+	return true;
+}
+
+static uint32_t flash_kv_size(uint16_t len)
+{
+	return FLASH_KV_HDR_SIZE + (((len & ~FLASH_KV_DELETED) + 7) & ~7);
+}
+
+/* FNV-1a over key, length and value */
+static uint32_t flash_kv_check(uint16_t key, uint16_t len,
+			       const uint8_t *data)
+{
+	uint32_t h = 0x811c9dc5;
+	uint32_t n = len & ~FLASH_KV_DELETED;
+	uint32_t i;
+
+	h = (h ^ (key & 0xff)) * 0x01000193;
+	h = (h ^ (key >> 8)) * 0x01000193;
+	h = (h ^ (len & 0xff)) * 0x01000193;
+	h = (h ^ (len >> 8)) * 0x01000193;
+	for (i = 0; i < n; i++) {
+		h = (h ^ data[i]) * 0x01000193;
+	}
+	return h;
+}
+
+static uint32_t flash_kv_end(const struct flash_kv *kv)
+{
+	const struct flash_kv_area *area = &kv->areas[kv->active];
+
+	return area->address + area->size;
+}
+
+static bool flash_kv_blank(const struct flash_kv_area *area)
+{
+	uint32_t i;
+
+	flash_kv_ecc_failed();
+	for (i = 0; i < area->size; i += 4) {
+		if (MMIO32(area->address + i) != FLASH_KV_ERASED) {
+			return false;
+		}
+	}
+	return !flash_kv_ecc_failed();
+}
+
+static struct flash_kv_entry *flash_kv_slot(struct flash_kv *kv, uint16_t key,
+					    bool insert)
+{
+	uint16_t mask = kv->index_size - 1;
+	uint16_t i = (key * 40503u) & mask;
+	uint16_t n;
+
+	for (n = 0; n < kv->index_size; n++, i = (i + 1) & mask) {
+		struct flash_kv_entry *e = &kv->index[i];
+
+		if (e->key == key) {
+			return e;
+		}
+		if (e->key == FLASH_KV_KEY_INVALID) {
+			if (insert) {
+				e->key = key;
+				e->addr = 0;
+				return e;
+			}
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+/* Point the index at a new record of a key. */
+static void flash_kv_set(struct flash_kv *kv, struct flash_kv_entry *e,
+			 uint32_t addr)
+{
+	if (e->addr) {
+		kv->live -= flash_kv_size(MMIO16(e->addr + 2));
+	}
+	e->addr = addr;
+	if (addr) {
+		kv->live += flash_kv_size(MMIO16(addr + 2));
+	}
+}
+
+/* Rebuild the index from the active area. A record that fails its check or
+ * reads with an ECC error can only be the last one, cut by a reset: the rest
+ * of the area is then left unused until the next compaction. */
+static void flash_kv_scan(struct flash_kv *kv)
+{
+	uint32_t p = kv->areas[kv->active].address + FLASH_KV_HDR_SIZE;
+	uint32_t end = flash_kv_end(kv);
+	uint16_t i;
+
+	for (i = 0; i < kv->index_size; i++) {
+		kv->index[i].key = FLASH_KV_KEY_INVALID;
+		kv->index[i].addr = 0;
+	}
+	kv->live = 0;
+	flash_kv_ecc_failed();
+
+	while (p + FLASH_KV_HDR_SIZE <= end) {
+		uint16_t key = MMIO16(p);
+		uint16_t len = MMIO16(p + 2);
+		uint32_t check = MMIO32(p + 4);
+		struct flash_kv_entry *e;
+
+		if (flash_kv_ecc_failed()) {
+			p = end;
+			break;
+		}
+		if (key == FLASH_KV_KEY_INVALID && len == 0xffff &&
+		    check == FLASH_KV_ERASED) {
+			break;
+		}
+		if (p + flash_kv_size(len) > end ||
+		    check != flash_kv_check(key, len,
+					    (const uint8_t *)(p + 8)) ||
+		    flash_kv_ecc_failed()) {
+			p = end;
+			break;
+		}
+		e = flash_kv_slot(kv, key, true);
+		if (e) {
+			flash_kv_set(kv, e, (len & FLASH_KV_DELETED) ? 0 : p);
+		}
+		p += flash_kv_size(len);
+	}
+	kv->write = p;
+}
+
+static void flash_kv_erase_pending(struct flash_kv *kv, uint8_t i)
+{
+	if (kv->pending & (1u << i)) {
+		flash_kv_erase(&kv->areas[i]);
+		kv->pending &= ~(1u << i);
+	}
+}
+
+static bool flash_kv_start_area(struct flash_kv *kv, uint8_t i, uint32_t seq)
+{
+	uint32_t hdr[2] = { FLASH_KV_MAGIC, seq };
+
+	if (!flash_kv_program(kv->areas[i].address, (const uint8_t *)hdr,
+			      sizeof(hdr))) {
+		return false;
+	}
+	kv->active = i;
+	kv->seq = seq;
+	return true;
+}
+
+/* Copy the records in use to the next area and make it the active one. On a
+ * programming error the next area is left for erasure and the active one is
+ * kept. */
+static bool flash_kv_compact(struct flash_kv *kv)
+{
+	uint8_t next = (kv->active + 1) % kv->nareas;
+	const struct flash_kv_area *area = &kv->areas[next];
+	uint32_t w = area->address + FLASH_KV_HDR_SIZE;
+	uint8_t prev = kv->active;
+	uint16_t i;
+
+	if (kv->live + FLASH_KV_HDR_SIZE > area->size) {
+		return false;
+	}
+	flash_kv_erase_pending(kv, next);
+
+	for (i = 0; i < kv->index_size; i++) {
+		uint32_t addr = kv->index[i].addr;
+		uint32_t size;
+
+		if (!addr) {
+			continue;
+		}
+		size = flash_kv_size(MMIO16(addr + 2));
+		if (!flash_kv_program(w, (const uint8_t *)addr, size)) {
+			kv->pending |= 1u << next;
+			return false;
+		}
+		w += size;
+	}
+
+	if (!flash_kv_start_area(kv, next, kv->seq + 1)) {
+		kv->pending |= 1u << next;
+		return false;
+	}
+	kv->pending |= 1u << prev;
+	flash_kv_scan(kv);
+	return true;
+}
+
+static bool flash_kv_append(struct flash_kv *kv, uint16_t key,
+			    const uint8_t *data, uint16_t len)
+{
+	uint32_t size = flash_kv_size(len);
+	struct flash_kv_entry *e;
+	uint16_t hdr[4];
+	uint32_t check = flash_kv_check(key, len, data);
+	uint32_t n = len & ~FLASH_KV_DELETED;
+	uint8_t tail[8] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	uint32_t i;
+
+	if (key == FLASH_KV_KEY_INVALID) {
+		return false;
+	}
+	e = flash_kv_slot(kv, key, true);
+	if (!e || kv->write + size > flash_kv_end(kv)) {
+		if (!flash_kv_compact(kv)) {
+			return false;
+		}
+		e = flash_kv_slot(kv, key, true);
+		if (!e || kv->write + size > flash_kv_end(kv)) {
+			return false;
+		}
+	}
+
+	/* Header first: a cut write then fails the check */
+	hdr[0] = key;
+	hdr[1] = len;
+	hdr[2] = check;
+	hdr[3] = check >> 16;
+	for (i = 0; i < (n & 7); i++) {
+		tail[i] = data[(n & ~7) + i];
+	}
+	if (!flash_kv_program(kv->write, (const uint8_t *)hdr, sizeof(hdr)) ||
+	    !flash_kv_program(kv->write + FLASH_KV_HDR_SIZE, data, n & ~7) ||
+	    ((n & 7) &&
+	     !flash_kv_program(kv->write + FLASH_KV_HDR_SIZE + (n & ~7),
+			       tail, sizeof(tail)))) {
+		/* Like a cut record: the rest of the area stays unused. */
+		kv->write = flash_kv_end(kv);
+		return false;
+	}
+
+	flash_kv_set(kv, e, (len & FLASH_KV_DELETED) ? 0 : kv->write);
+	kv->write += size;
+	return true;
+}
+
+/** @brief Open a key-value store
+ *
+ * Finds the active area, rebuilds the index from it and schedules the other
+ * areas for erasure unless they are blank. Without an active area, the store
+ * is created empty in the first area.
+ *
+ * @param[out] kv store
+ * @param[in] areas areas to use, at most 32, must stay valid
+ * @param[in] nareas number of areas, at least 2
+ * @param[in] index storage for the index
+ * @param[in] index_size entries in index, a power of two larger than the
+ * number of keys
+ * @returns false if the arguments are invalid or a new store couldn't be
+ * written
+ */
+bool flash_kv_init(struct flash_kv *kv, const struct flash_kv_area *areas,
+		   uint8_t nareas, struct flash_kv_entry *index,
+		   uint16_t index_size)
+{
+	bool found = false;
+	uint8_t i;
+
+	if (nareas < 2 || nareas > 32 || index_size == 0 ||
+	    (index_size & (index_size - 1))) {
+		return false;
+	}
+	kv->areas = areas;
+	kv->nareas = nareas;
+	kv->index = index;
+	kv->index_size = index_size;
+	kv->pending = 0;
+	kv->active = 0;
+	kv->seq = 0;
+
+	flash_kv_ecc_failed();
+	for (i = 0; i < nareas; i++) {
+		uint32_t magic = MMIO32(areas[i].address);
+		uint32_t seq = MMIO32(areas[i].address + 4);
+
+		/* A cut header: the copy it ends is incomplete */
+		if (flash_kv_ecc_failed()) {
+			continue;
+		}
+		if (magic == FLASH_KV_MAGIC && (!found || seq > kv->seq)) {
+			kv->active = i;
+			kv->seq = seq;
+			found = true;
+		}
+	}
+	for (i = 0; i < nareas; i++) {
+		if ((!found || i != kv->active) && !flash_kv_blank(&areas[i])) {
+			kv->pending |= 1u << i;
+		}
+	}
+
+	if (!found) {
+		flash_kv_erase_pending(kv, 0);
+		if (!flash_kv_start_area(kv, 0, 1)) {
+			return false;
+		}
+	}
+	flash_kv_scan(kv);
+	return true;
+}
+
+/** @brief Read a value
+ *
+ * @param[in] kv store
+ * @param[in] key key
+ * @param[out] buf buffer for the value
+ * @param[in] size size of buf, longer values are truncated
+ * @returns length of the value, -1 if the key doesn't exist
+ */
+int flash_kv_read(struct flash_kv *kv, uint16_t key, void *buf, size_t size)
+{
+	struct flash_kv_entry *e = flash_kv_slot(kv, key, false);
+	const uint8_t *src;
+	uint8_t *dst = buf;
+	uint16_t len;
+	size_t i;
+
+	if (!e || !e->addr) {
+		return -1;
+	}
+	len = MMIO16(e->addr + 2);
+	src = (const uint8_t *)(e->addr + FLASH_KV_HDR_SIZE);
+	for (i = 0; i < len && i < size; i++) {
+		dst[i] = src[i];
+	}
+	return len;
+}
+
+/** @brief Write a value
+ *
+ * Appends a record, after a compaction if the active area is full.
+ *
+ * @param[in] kv store
+ * @param[in] key key, not FLASH_KV_KEY_INVALID
+ * @param[in] data value
+ * @param[in] len length of the value, at most FLASH_KV_MAX_LEN
+ * @returns false if the store is full, the index has no free entry or
+ * programming failed
+ */
+bool flash_kv_write(struct flash_kv *kv, uint16_t key, const void *data,
+		    size_t len)
+{
+	if (len > FLASH_KV_MAX_LEN) {
+		return false;
+	}
+	return flash_kv_append(kv, key, data, len);
+}
+
+/** @brief Delete a value
+ *
+ * @param[in] kv store
+ * @param[in] key key
+ * @returns false if the deletion couldn't be written
+ */
+bool flash_kv_delete(struct flash_kv *kv, uint16_t key)
+{
+	struct flash_kv_entry *e = flash_kv_slot(kv, key, false);
+
+	if (!e || !e->addr) {
+		return true;
+	}
+	return flash_kv_append(kv, key, NULL, FLASH_KV_DELETED);
+}
+
+/** @brief Handle a flash ECC error of the key-value store
+ *
+ * On G0/G4/L4, reading a double word cut by a power failure can raise an
+ * NMI. The application's nmi_handler() calls this, the store then treats
+ * the record as cut. Does nothing on other families.
+ *
+ * @returns true if the NMI was raised by a flash ECC error, which is cleared
+ */
+bool flash_kv_nmi_handler(void)
+{
+#if defined(FLASH_ECCR_ECCD)
+	if (FLASH_ECCR & FLASH_ECCR_ECCD) {
+		FLASH_ECCR |= FLASH_ECCR_ECCD;
+		flash_kv_ecc_error = true;
+		return true;
+	}
+#endif
+	return false;
+}
+
+/** @brief Run background work of the key-value store
+ *
+ * Erases one area left over by a compaction, or compacts the active area in
+ * advance when it is three quarters full and mostly holds stale records. To
+ * be called when the application is idle, the flash is busy meanwhile.
+ *
+ * @param[in] kv store
+ * @returns true while more work is pending
+ */
+bool flash_kv_poll(struct flash_kv *kv)
+{
+	const struct flash_kv_area *area = &kv->areas[kv->active];
+	uint32_t used = kv->write - area->address;
+	uint8_t i;
+
+	for (i = 0; i < kv->nareas; i++) {
+		if (kv->pending & (1u << i)) {
+			flash_kv_erase_pending(kv, i);
+			return kv->pending != 0;
+		}
+	}
+
+	if (used > area->size / 4 * 3 && kv->live < used / 2) {
+		flash_kv_compact(kv);
+	}
+	return kv->pending != 0;
+}
+
+/**@}*/
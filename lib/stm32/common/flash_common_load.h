@@ -0,0 +1,47 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This is a "private" header file for the flash drivers that program data
+ * blocks of any alignment. The flash takes whole words, but LDRD and LDM
+ * fault on unaligned addresses even where single loads don't.
+ */
+
+#ifndef FLASH_COMMON_LOAD
+#define FLASH_COMMON_LOAD
+
+#include <libopencm3/cm3/common.h>
+
+/* Load a little endian word from any address. Always inlined, so that it
+ * ends up in RAM together with callers placed there by FLASH_RAMFUNC. */
+static inline __attribute__((always_inline))
+uint32_t flash_load_word(const uint8_t *p)
+{
+	if (((uintptr_t)p & 3) == 0) {
+		return *(const uint32_t *)p;
+	}
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Load a little endian double word from any address. */
+static inline __attribute__((always_inline))
+uint64_t flash_load_double_word(const uint8_t *p)
+{
+	return flash_load_word(p) | ((uint64_t)flash_load_word(p + 4) << 32);
+}
+
+#endif
@@ -8,6 +8,25 @@
  * This library supports the HASH processor in the STM32F2 and STM32F4
  * series of ARM Cortex Microcontrollers by ST Microelectronics.
  *
+ * Besides the register level functions, a streaming API hashes byte buffers
+ * of any length and alignment: hash_start() or hash_hmac_start(), any number
+ * of hash_update() and hash_finish(). The last part of the message, usually
+ * the bulk of it, can be fed by DMA with hash_finish_dma(). There is a single
+ * HASH processor, so only one calculation can run at a time.
+ *
+ * Example:
+ * @code
+ *	struct hash_context ctx;
+ *	uint32_t digest[5];
+ *
+ *	hash_start(&ctx, HASH_ALGO_SHA1);
+ *	hash_update(&ctx, hdr, sizeof(hdr));
+ *	hash_finish_dma(&ctx, image, image_len, DMA2, DMA_STREAM7);
+ *	if (!hash_finish(&ctx, digest)) {
+ *		... the DMA transfer failed, start over ...
+ *	}
+ * @endcode
+ *
  * LGPL License Terms @ref lgpl_license
  *  */
 
@@ -33,6 +52,7 @@
 /**@{*/
 
 #include <libopencm3/stm32/hash.h>
+#include "dma_common_periph.h"
 
 /*---------------------------------------------------------------------------*/
 /** @brief HASH Set Mode
@@ -160,5 +180,248 @@ void hash_get_result(uint32_t *data)
 		data[4] = HASH_HR[4];
 	}
 }
+
+enum {
+	HASH_PHASE_UPDATE,
+	HASH_PHASE_DMA,
+	HASH_PHASE_DIGEST,
+	HASH_PHASE_ERROR,
+};
+
+/* HASH keys longer than a block are hashed first. */
+#define HASH_BLOCK_SIZE		64
+/* Words per DMA transfer */
+#define HASH_DMA_MAX		0xFFFF
+
+/* The data type is 8 bit, so words are fed in memory order. */
+static void hash_feed(struct hash_context *ctx, const uint8_t *data,
+		      size_t len)
+{
+	while (len && ctx->npartial) {
+		ctx->partial |= (uint32_t)*data++ << (8 * ctx->npartial);
+		len--;
+		if (++ctx->npartial == 4) {
+			HASH_DIN = ctx->partial;
+			ctx->partial = 0;
+			ctx->npartial = 0;
+		}
+	}
+
+	if (((uintptr_t)data & 3) == 0) {
+		for (; len >= 4; len -= 4, data += 4) {
+			HASH_DIN = *(const uint32_t *)data;
+		}
+	} else {
+		for (; len >= 4; len -= 4, data += 4) {
+			HASH_DIN = data[0] | (data[1] << 8) | (data[2] << 16) |
+				   ((uint32_t)data[3] << 24);
+		}
+	}
+
+	while (len--) {
+		ctx->partial |= (uint32_t)*data++ << (8 * ctx->npartial);
+		ctx->npartial++;
+	}
+}
+
+/* Close a phase: NBLW, the incomplete word and DCAL. */
+static void hash_last(struct hash_context *ctx)
+{
+	HASH_STR = 8 * ctx->npartial;
+	if (ctx->npartial) {
+		HASH_DIN = ctx->partial;
+	}
+	HASH_STR = (8 * ctx->npartial) | HASH_STR_DCAL;
+	ctx->partial = 0;
+	ctx->npartial = 0;
+}
+
+static void hash_begin(struct hash_context *ctx, uint32_t cr)
+{
+	ctx->cr = cr;
+	ctx->partial = 0;
+	ctx->npartial = 0;
+	ctx->phase = HASH_PHASE_UPDATE;
+	HASH_CR = cr | HASH_DATA_8BIT | HASH_CR_INIT;
+}
+
+/* Feed the HMAC key as a phase of its own. */
+static void hash_key_phase(struct hash_context *ctx)
+{
+	hash_feed(ctx, ctx->key, ctx->keylen);
+	hash_last(ctx);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief HASH Start a hash calculation
+
+@param[out] ctx calculation state
+@param[in] algorithm unsigned int8. Hash algorithm: @ref hash_algorithm
+*/
+
+void hash_start(struct hash_context *ctx, uint8_t algorithm)
+{
+	ctx->key = NULL;
+	ctx->keylen = 0;
+	hash_begin(ctx, HASH_MODE_HASH | algorithm);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief HASH Start a HMAC calculation
+
+The inner key phase is run immediately, the outer one by hash_finish().
+
+@param[out] ctx calculation state
+@param[in] algorithm unsigned int8. Hash algorithm: @ref hash_algorithm
+@param[in] key HMAC key, must stay valid until hash_finish()
+@param[in] keylen key length in bytes
+*/
+
+void hash_hmac_start(struct hash_context *ctx, uint8_t algorithm,
+		     const uint8_t *key, size_t keylen)
+{
+	uint32_t cr = HASH_MODE_HMAC | algorithm;
+
+	if (keylen > HASH_BLOCK_SIZE) {
+		cr |= HASH_CR_LKEY;
+	}
+	ctx->key = key;
+	ctx->keylen = keylen;
+	hash_begin(ctx, cr);
+	hash_key_phase(ctx);
+	while (HASH_SR & HASH_SR_BUSY);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief HASH Add bytes to the message
+
+@param[in] ctx calculation state
+@param[in] data bytes to add, any alignment
+@param[in] len number of bytes
+*/
+
+void hash_update(struct hash_context *ctx, const void *data, size_t len)
+{
+	hash_feed(ctx, data, len);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief HASH Add the last bytes of the message by DMA
+
+The HASH processor starts the digest calculation at the end of a DMA
+transfer, so DMA can only be used for the end of the message: bytes that
+exceed a single transfer are fed by the CPU first. The buffer is read in
+whole words, up to 3 bytes past its end. Unaligned buffers are fed by the CPU.
+The application maps the HASH DMA request (DMA2 stream 7, channel 2 on F2/F4).
+
+@param[in] ctx calculation state
+@param[in] data last bytes of the message, must stay valid until finished
+@param[in] len number of bytes
+@param[in] dma DMA controller
+@param[in] ch DMA stream serving the HASH request
+*/
+
+void hash_finish_dma(struct hash_context *ctx, const void *data, size_t len,
+		     uint32_t dma, uint8_t ch)
+{
+	const uint8_t *buf = data;
+	size_t n;
+
+	/* Complete the current word by CPU, then the DMA starts on a word. */
+	if (ctx->npartial) {
+		n = 4 - ctx->npartial;
+		if (n > len) {
+			n = len;
+		}
+		hash_feed(ctx, buf, n);
+		buf += n;
+		len -= n;
+	}
+	if (ctx->npartial || ((uintptr_t)buf & 3) || len == 0) {
+		hash_feed(ctx, buf, len);
+		hash_last(ctx);
+		ctx->phase = HASH_PHASE_DIGEST;
+		return;
+	}
+
+	if (len > HASH_DMA_MAX * 4) {
+		n = (len - HASH_DMA_MAX * 4 + 3) & ~3;
+		hash_feed(ctx, buf, n);
+		buf += n;
+		len -= n;
+	}
+
+	ctx->dma = dma;
+	ctx->ch = ch;
+	ctx->phase = HASH_PHASE_DMA;
+	HASH_STR = 8 * (len & 3);
+	dma_periph_setup(dma, ch, (uint32_t)&HASH_DIN, (uint32_t)buf,
+			 (len + 3) / 4, 4, true, true);
+	dma_enable_transfer_complete_interrupt(dma, ch);
+	dma_enable_transfer_error_interrupt(dma, ch);
+	HASH_CR |= HASH_CR_DMAE;
+	dma_periph_enable(dma, ch);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief HASH Check for the end of the DMA transfer
+
+Can be polled or called from the interrupt of the DMA stream. A transfer
+error ends the transfer too, hash_finish() then reports the failure.
+
+@param[in] ctx calculation state
+@returns true while the DMA transfer started by hash_finish_dma() is running
+*/
+
+bool hash_dma_busy(struct hash_context *ctx)
+{
+	if (ctx->phase != HASH_PHASE_DMA) {
+		return false;
+	}
+	if (!dma_get_interrupt_flag(ctx->dma, ctx->ch, DMA_TCIF | DMA_TEIF)) {
+		return true;
+	}
+	/* After a transfer error the message is incomplete, no digest follows. */
+	if (dma_get_interrupt_flag(ctx->dma, ctx->ch, DMA_TEIF)) {
+		ctx->phase = HASH_PHASE_ERROR;
+	} else {
+		ctx->phase = HASH_PHASE_DIGEST;
+	}
+	dma_periph_disable(ctx->dma, ctx->ch);
+	dma_clear_interrupt_flags(ctx->dma, ctx->ch, DMA_TCIF | DMA_TEIF);
+	HASH_CR &= ~HASH_CR_DMAE;
+	return false;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief HASH Finish the calculation and read the digest
+
+Waits for a DMA transfer started by hash_finish_dma(), otherwise closes the
+message. For HMAC, runs the outer key phase.
+
+@param[in] ctx calculation state
+@param[out] digest unsigned int32. 4\5 words depending on the algorithm.
+@returns false if the DMA transfer failed, digest is then left untouched
+*/
+
+bool hash_finish(struct hash_context *ctx, uint32_t *digest)
+{
+	while (hash_dma_busy(ctx));
+	if (ctx->phase == HASH_PHASE_ERROR) {
+		return false;
+	}
+	if (ctx->phase == HASH_PHASE_UPDATE) {
+		hash_last(ctx);
+	}
+	ctx->phase = HASH_PHASE_DIGEST;
+
+	if ((ctx->cr & HASH_CR_MODE) == HASH_MODE_HMAC) {
+		while (HASH_SR & HASH_SR_BUSY);
+		hash_key_phase(ctx);
+	}
+	while (!(HASH_SR & HASH_SR_DCIS));
+	hash_get_result(digest);
+	return true;
+}
 /**@}*/
 
@@ -36,8 +36,10 @@ register access, Error conditions
  * along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/stm32/i2c.h>
 #include <libopencm3/stm32/rcc.h>
+#include "dma_common_periph.h"
 
 /**@{*/
 
@@ -571,4 +573,388 @@ void i2c_set_speed(uint32_t i2c, enum i2c_speeds speed, uint32_t clock_megahz)
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* Non blocking transfer queue */
+
+#define I2C_TRANSFER_IDLE	0
+#define I2C_TRANSFER_WRITE	1
+#define I2C_TRANSFER_READ	2
+
+#define I2C_SR1_ERRORS		(I2C_SR1_TIMEOUT | I2C_SR1_OVR | I2C_SR1_AF | \
+				 I2C_SR1_ARLO | I2C_SR1_BERR)
+
+static void i2c_transfer_start(struct i2c_transfer_queue *queue);
+
+static void i2c_transfer_start_phase(struct i2c_transfer_queue *queue)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t i2c = queue->i2c;
+	bool read = queue->state == I2C_TRANSFER_READ;
+	uint32_t cr2 = I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+
+	queue->pos = 0;
+	queue->left = read ? xfer->rn : xfer->wn;
+
+	I2C_CR2(i2c) &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITBUFEN);
+	if (queue->dma && (read ? (xfer->rn >= 2) : (xfer->wn > 0))) {
+		if (read) {
+			dma_periph_setup(queue->dma, queue->rx_ch,
+					 (uint32_t)&I2C_DR(i2c),
+					 (uint32_t)xfer->r, xfer->rn, 1,
+					 false, true);
+			dma_enable_transfer_complete_interrupt(queue->dma,
+							       queue->rx_ch);
+			dma_enable_transfer_error_interrupt(queue->dma,
+							    queue->rx_ch);
+			dma_periph_enable(queue->dma, queue->rx_ch);
+			/* NACK the last byte without software help */
+			cr2 |= I2C_CR2_LAST;
+		} else {
+			dma_periph_setup(queue->dma, queue->tx_ch,
+					 (uint32_t)&I2C_DR(i2c),
+					 (uint32_t)xfer->w, xfer->wn, 1,
+					 true, true);
+			dma_periph_enable(queue->dma, queue->tx_ch);
+		}
+		cr2 |= I2C_CR2_DMAEN;
+	} else {
+		cr2 |= I2C_CR2_ITBUFEN;
+	}
+
+	if (read) {
+		I2C_CR1(i2c) |= I2C_CR1_ACK;
+		if ((xfer->rn == 2) && !(cr2 & I2C_CR2_DMAEN)) {
+			I2C_CR1(i2c) |= I2C_CR1_POS;
+		} else {
+			I2C_CR1(i2c) &= ~I2C_CR1_POS;
+		}
+	}
+
+	I2C_CR2(i2c) |= cr2;
+	i2c_send_start(i2c);
+}
+
+static void i2c_transfer_finish(struct i2c_transfer_queue *queue,
+				enum i2c_transfer_status status)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t i2c = queue->i2c;
+
+	I2C_CR2(i2c) &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN |
+			  I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+	I2C_CR1(i2c) &= ~I2C_CR1_POS;
+	if (queue->dma) {
+		dma_periph_disable(queue->dma, queue->tx_ch);
+		dma_periph_disable(queue->dma, queue->rx_ch);
+	}
+	queue->state = I2C_TRANSFER_IDLE;
+
+	xfer->status = status;
+	queue->head = xfer->next;
+	if (queue->head) {
+		/* START must not be set before the STOP has gone out. */
+		while (I2C_CR1(i2c) & I2C_CR1_STOP);
+		i2c_transfer_start(queue);
+	} else {
+		queue->tail = NULL;
+	}
+
+	if (xfer->callback) {
+		xfer->callback(xfer);
+	}
+}
+
+static void i2c_transfer_start(struct i2c_transfer_queue *queue)
+{
+	struct i2c_transfer *xfer = queue->head;
+
+	queue->error = I2C_TRANSFER_PENDING;
+	/* A transfer without data still addresses the slave (probe). */
+	if (xfer->wn || !xfer->rn) {
+		queue->state = I2C_TRANSFER_WRITE;
+	} else {
+		queue->state = I2C_TRANSFER_READ;
+	}
+	I2C_SR1(queue->i2c) = ~I2C_SR1_ERRORS;
+	i2c_transfer_start_phase(queue);
+}
+
+static void i2c_transfer_write_event(struct i2c_transfer_queue *queue,
+				     uint32_t sr1)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t i2c = queue->i2c;
+	bool dma = I2C_CR2(i2c) & I2C_CR2_DMAEN;
+
+	if (!dma && (sr1 & I2C_SR1_TxE) && (queue->pos < xfer->wn)) {
+		I2C_DR(i2c) = xfer->w[queue->pos++];
+		if (queue->pos == xfer->wn) {
+			/* Only BTF is of interest from now on. */
+			I2C_CR2(i2c) &= ~I2C_CR2_ITBUFEN;
+		}
+		return;
+	}
+
+	if (!(sr1 & I2C_SR1_BTF) && xfer->wn) {
+		return;
+	}
+	if (dma ? dma_get_number_of_data(queue->dma, queue->tx_ch) :
+		  (queue->pos != xfer->wn)) {
+		return;
+	}
+
+	if (xfer->rn) {
+		queue->state = I2C_TRANSFER_READ;
+		i2c_transfer_start_phase(queue);
+	} else {
+		i2c_send_stop(i2c);
+		i2c_transfer_finish(queue, I2C_TRANSFER_DONE);
+	}
+}
+
+static void i2c_transfer_read_event(struct i2c_transfer_queue *queue,
+				    uint32_t sr1)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t i2c = queue->i2c;
+
+	if (xfer->rn == 1) {
+		if (sr1 & I2C_SR1_RxNE) {
+			xfer->r[0] = I2C_DR(i2c);
+			i2c_transfer_finish(queue, I2C_TRANSFER_DONE);
+		}
+	} else if (xfer->rn == 2) {
+		/* Both bytes received, the second one NACKed (POS). */
+		if (sr1 & I2C_SR1_BTF) {
+			i2c_send_stop(i2c);
+			xfer->r[0] = I2C_DR(i2c);
+			xfer->r[1] = I2C_DR(i2c);
+			i2c_transfer_finish(queue, I2C_TRANSFER_DONE);
+		}
+	} else if (queue->left > 3) {
+		if (sr1 & I2C_SR1_RxNE) {
+			xfer->r[queue->pos++] = I2C_DR(i2c);
+			if (--queue->left == 3) {
+				/* Wait for BTF to NACK the last byte. */
+				I2C_CR2(i2c) &= ~I2C_CR2_ITBUFEN;
+			}
+		}
+	} else if (sr1 & I2C_SR1_BTF) {
+		if (queue->left == 3) {
+			/* N-2 in DR, N-1 in the shift register */
+			i2c_disable_ack(i2c);
+			xfer->r[queue->pos++] = I2C_DR(i2c);
+			queue->left--;
+		} else {
+			i2c_send_stop(i2c);
+			xfer->r[queue->pos++] = I2C_DR(i2c);
+			xfer->r[queue->pos++] = I2C_DR(i2c);
+			i2c_transfer_finish(queue, I2C_TRANSFER_DONE);
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Initialise a non blocking transfer queue
+
+The queue is interrupt driven, see i2c_transfer_queue_set_dma() to move the
+data with the DMA controller instead. The application configures and enables
+the I2C peripheral, enables its event and error interrupts in the NVIC and
+calls i2c_transfer_irq_handler() from both.
+
+@param[in] queue queue to initialise
+@param[in] i2c Unsigned int32. I2C register base address @ref i2c_reg_base.
+*/
+void i2c_transfer_queue_init(struct i2c_transfer_queue *queue, uint32_t i2c)
+{
+	queue->i2c = i2c;
+	queue->dma = 0;
+	queue->head = NULL;
+	queue->tail = NULL;
+	queue->state = I2C_TRANSFER_IDLE;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Move the data of queued transfers by DMA
+
+Writes and reads of two or more bytes then use DMA, single byte reads are
+always interrupt driven. The DMA request mapping is left as configured by the
+application, which must call i2c_transfer_dma_irq_handler() from the RX
+stream/channel interrupt to end the reads.
+
+@param[in] queue transfer queue
+@param[in] dma Unsigned int32. DMA controller base address, 0 to disable
+@param[in] tx_ch Unsigned int8. DMA stream/channel serving I2C TX
+@param[in] rx_ch Unsigned int8. DMA stream/channel serving I2C RX
+*/
+void i2c_transfer_queue_set_dma(struct i2c_transfer_queue *queue,
+				uint32_t dma, uint8_t tx_ch, uint8_t rx_ch)
+{
+	queue->dma = dma;
+	queue->tx_ch = tx_ch;
+	queue->rx_ch = rx_ch;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Queue a transfer
+
+The transfer is started immediately if the queue is idle, otherwise it is
+started from the interrupt handler once the previous transfers are done.
+
+@param[in] queue transfer queue
+@param[in] xfer transfer descriptor, must stay valid until completed
+*/
+void i2c_transfer_submit(struct i2c_transfer_queue *queue,
+			 struct i2c_transfer *xfer)
+{
+	xfer->status = I2C_TRANSFER_PENDING;
+	xfer->next = NULL;
+
+	CM_ATOMIC_BLOCK() {
+		if (queue->head) {
+			queue->tail->next = xfer;
+			queue->tail = xfer;
+		} else {
+			queue->head = xfer;
+			queue->tail = xfer;
+			i2c_transfer_start(queue);
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Check for pending transfers
+
+@param[in] queue transfer queue
+@returns true if transfers are running or queued
+*/
+bool i2c_transfer_queue_busy(const struct i2c_transfer_queue *queue)
+{
+	return queue->head != NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Interrupt handler for the transfer queue
+
+To be called from the I2C event and error interrupts. Runs the SB, ADDR, TxE,
+RxNE and BTF sequence of the master, including the special handling of one
+and two byte reads. Acknowledge failure, arbitration loss, bus errors,
+overruns and SMBus timeouts complete the running transfer with the matching
+error status.
+
+@param[in] queue transfer queue
+*/
+void i2c_transfer_irq_handler(struct i2c_transfer_queue *queue)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t i2c = queue->i2c;
+	uint32_t sr1 = I2C_SR1(i2c);
+	bool read = queue->state == I2C_TRANSFER_READ;
+
+	if (!xfer) {
+		return;
+	}
+
+	if (sr1 & I2C_SR1_ERRORS) {
+		I2C_SR1(i2c) = ~I2C_SR1_ERRORS;
+		if (sr1 & I2C_SR1_ARLO) {
+			/* The bus has already been released. */
+			i2c_transfer_finish(queue, I2C_TRANSFER_ARLO);
+			return;
+		}
+		i2c_send_stop(i2c);
+		if (sr1 & I2C_SR1_AF) {
+			i2c_transfer_finish(queue, I2C_TRANSFER_NACK);
+		} else if (sr1 & I2C_SR1_TIMEOUT) {
+			i2c_transfer_finish(queue, I2C_TRANSFER_TIMEOUT);
+		} else {
+			i2c_transfer_finish(queue, I2C_TRANSFER_BUS_ERROR);
+		}
+		return;
+	}
+
+	if (sr1 & I2C_SR1_SB) {
+		i2c_send_7bit_address(i2c, xfer->addr,
+				      read ? I2C_READ : I2C_WRITE);
+		return;
+	}
+
+	if (sr1 & I2C_SR1_ADDR) {
+		if (read && (xfer->rn == 1)) {
+			/* NACK and STOP must be set around clearing ADDR. */
+			i2c_disable_ack(i2c);
+			(void)I2C_SR2(i2c);
+			i2c_send_stop(i2c);
+		} else {
+			(void)I2C_SR2(i2c);
+			if (read && !(I2C_CR2(i2c) & I2C_CR2_DMAEN) &&
+			    (xfer->rn <= 3)) {
+				/* Only BTF is used, RxNE would keep firing. */
+				I2C_CR2(i2c) &= ~I2C_CR2_ITBUFEN;
+				if (xfer->rn == 2) {
+					i2c_disable_ack(i2c);
+				}
+			}
+		}
+		if (!read && !xfer->wn) {
+			i2c_transfer_write_event(queue, sr1);
+		}
+		return;
+	}
+
+	if (read) {
+		if (!(I2C_CR2(i2c) & I2C_CR2_DMAEN)) {
+			i2c_transfer_read_event(queue, sr1);
+		}
+	} else {
+		i2c_transfer_write_event(queue, sr1);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C DMA interrupt handler for the transfer queue
+
+To be called from the interrupt of the RX DMA stream/channel when the queue
+uses DMA. Generates the STOP after the last byte of a read has been moved.
+
+@param[in] queue transfer queue
+*/
+void i2c_transfer_dma_irq_handler(struct i2c_transfer_queue *queue)
+{
+	bool error = dma_get_interrupt_flag(queue->dma, queue->rx_ch,
+					    DMA_TEIF);
+
+	if (!error && !dma_get_interrupt_flag(queue->dma, queue->rx_ch,
+					      DMA_TCIF)) {
+		return;
+	}
+	dma_clear_interrupt_flags(queue->dma, queue->rx_ch,
+				  DMA_TCIF | DMA_TEIF);
+
+	if (queue->head && (queue->state == I2C_TRANSFER_READ)) {
+		i2c_send_stop(queue->i2c);
+		i2c_transfer_finish(queue, error ? I2C_TRANSFER_BUS_ERROR :
+						   I2C_TRANSFER_DONE);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Abort the running transfer
+
+Intended for application level timeouts. A STOP is requested and the running
+transfer completes with I2C_TRANSFER_TIMEOUT. Queued transfers are then
+started.
+
+@param[in] queue transfer queue
+*/
+void i2c_transfer_abort(struct i2c_transfer_queue *queue)
+{
+	CM_ATOMIC_BLOCK() {
+		if (queue->head) {
+			i2c_send_stop(queue->i2c);
+			i2c_transfer_finish(queue, I2C_TRANSFER_TIMEOUT);
+		}
+	}
+}
+
 /**@}*/
@@ -19,8 +19,10 @@
  * along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/stm32/i2c.h>
 #include <libopencm3/stm32/rcc.h>
+#include "dma_common_periph.h"
 
 /**@{*/
 
@@ -483,4 +485,289 @@ void i2c_set_speed(uint32_t i2c, enum i2c_speeds speed, uint32_t clock_megahz)
 	}
 }
 
+/*---------------------------------------------------------------------------*/
+/* Non blocking transfer queue */
+
+#define I2C_TRANSFER_IDLE	0
+#define I2C_TRANSFER_WRITE	1
+#define I2C_TRANSFER_READ	2
+
+#define I2C_TRANSFER_IRQS	(I2C_CR1_ERRIE | I2C_CR1_TCIE | I2C_CR1_STOPIE | \
+				 I2C_CR1_NACKIE | I2C_CR1_RXIE | I2C_CR1_TXIE)
+
+static void i2c_transfer_start(struct i2c_transfer_queue *queue);
+
+/* NBYTES/RELOAD/AUTOEND for the next (up to 255 byte) chunk of the phase */
+static uint32_t i2c_transfer_next_chunk(struct i2c_transfer_queue *queue)
+{
+	size_t n = (queue->left > 255) ? 255 : queue->left;
+	uint32_t cr2 = n << I2C_CR2_NBYTES_SHIFT;
+
+	queue->left -= n;
+	if (queue->left) {
+		cr2 |= I2C_CR2_RELOAD;
+	} else if ((queue->state == I2C_TRANSFER_READ) ||
+		   (queue->head->rn == 0)) {
+		cr2 |= I2C_CR2_AUTOEND;
+	}
+	return cr2;
+}
+
+static void i2c_transfer_start_phase(struct i2c_transfer_queue *queue)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t i2c = queue->i2c;
+	bool read = queue->state == I2C_TRANSFER_READ;
+
+	queue->pos = 0;
+	queue->left = read ? xfer->rn : xfer->wn;
+
+	if (queue->dma && queue->left) {
+		if (read) {
+			dma_periph_setup(queue->dma, queue->rx_ch,
+					 (uint32_t)&I2C_RXDR(i2c),
+					 (uint32_t)xfer->r, queue->left, 1,
+					 false, true);
+			dma_periph_enable(queue->dma, queue->rx_ch);
+			i2c_enable_rxdma(i2c);
+		} else {
+			dma_periph_setup(queue->dma, queue->tx_ch,
+					 (uint32_t)&I2C_TXDR(i2c),
+					 (uint32_t)xfer->w, queue->left, 1,
+					 true, true);
+			dma_periph_enable(queue->dma, queue->tx_ch);
+			i2c_enable_txdma(i2c);
+		}
+	}
+
+	I2C_CR2(i2c) = ((uint32_t)xfer->addr << I2C_CR2_SADD_7BIT_SHIFT) |
+		       (read ? I2C_CR2_RD_WRN : 0) |
+		       i2c_transfer_next_chunk(queue) | I2C_CR2_START;
+}
+
+static void i2c_transfer_finish(struct i2c_transfer_queue *queue,
+				enum i2c_transfer_status status)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t i2c = queue->i2c;
+
+	I2C_CR1(i2c) &= ~(I2C_TRANSFER_IRQS | I2C_CR1_TXDMAEN |
+			  I2C_CR1_RXDMAEN);
+	if (queue->dma) {
+		dma_periph_disable(queue->dma, queue->tx_ch);
+		dma_periph_disable(queue->dma, queue->rx_ch);
+	}
+	queue->state = I2C_TRANSFER_IDLE;
+
+	xfer->status = status;
+	queue->head = xfer->next;
+	if (queue->head) {
+		i2c_transfer_start(queue);
+	} else {
+		queue->tail = NULL;
+	}
+
+	if (xfer->callback) {
+		xfer->callback(xfer);
+	}
+}
+
+static void i2c_transfer_start(struct i2c_transfer_queue *queue)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t irqs = I2C_CR1_ERRIE | I2C_CR1_TCIE | I2C_CR1_STOPIE |
+			I2C_CR1_NACKIE;
+
+	if (!queue->dma) {
+		irqs |= I2C_CR1_RXIE | I2C_CR1_TXIE;
+	}
+
+	queue->error = I2C_TRANSFER_PENDING;
+	/* A transfer without data still addresses the slave (probe). */
+	if (xfer->wn || !xfer->rn) {
+		queue->state = I2C_TRANSFER_WRITE;
+	} else {
+		queue->state = I2C_TRANSFER_READ;
+	}
+	I2C_ICR(queue->i2c) = I2C_ICR_NACKCF | I2C_ICR_STOPCF |
+			      I2C_ICR_ARLOCF | I2C_ICR_BERRCF |
+			      I2C_ICR_OVRCF | I2C_ICR_TIMOUTCF;
+	I2C_CR1(queue->i2c) |= irqs;
+	i2c_transfer_start_phase(queue);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Initialise a non blocking transfer queue
+ *
+ * The queue is interrupt driven, see i2c_transfer_queue_set_dma() to move the
+ * data with the DMA controller instead. The application configures and
+ * enables the I2C peripheral, enables its event (and error) interrupts in the
+ * NVIC and calls i2c_transfer_irq_handler() from them.
+ *
+ * @param[in] queue queue to initialise
+ * @param[in] i2c Unsigned int32. I2C register base address @ref i2c_reg_base.
+ */
+void i2c_transfer_queue_init(struct i2c_transfer_queue *queue, uint32_t i2c)
+{
+	queue->i2c = i2c;
+	queue->dma = 0;
+	queue->head = NULL;
+	queue->tail = NULL;
+	queue->state = I2C_TRANSFER_IDLE;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Move the data of queued transfers by DMA
+ *
+ * The DMA request mapping is left as configured by the application. No DMA
+ * interrupts are used, the end of each phase is still signalled by the I2C
+ * peripheral. Each phase is limited to 65535 bytes.
+ *
+ * @param[in] queue transfer queue
+ * @param[in] dma Unsigned int32. DMA controller base address, 0 to disable
+ * @param[in] tx_ch Unsigned int8. DMA stream/channel serving I2C TX
+ * @param[in] rx_ch Unsigned int8. DMA stream/channel serving I2C RX
+ */
+void i2c_transfer_queue_set_dma(struct i2c_transfer_queue *queue,
+				uint32_t dma, uint8_t tx_ch, uint8_t rx_ch)
+{
+	queue->dma = dma;
+	queue->tx_ch = tx_ch;
+	queue->rx_ch = rx_ch;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Queue a transfer
+ *
+ * The transfer is started immediately if the queue is idle, otherwise it is
+ * started from the interrupt handler once the previous transfers are done.
+ * Transfers longer than 255 bytes are split with NBYTES reloads.
+ *
+ * @param[in] queue transfer queue
+ * @param[in] xfer transfer descriptor, must stay valid until completed
+ */
+void i2c_transfer_submit(struct i2c_transfer_queue *queue,
+			 struct i2c_transfer *xfer)
+{
+	xfer->status = I2C_TRANSFER_PENDING;
+	xfer->next = NULL;
+
+	CM_ATOMIC_BLOCK() {
+		if (queue->head) {
+			queue->tail->next = xfer;
+			queue->tail = xfer;
+		} else {
+			queue->head = xfer;
+			queue->tail = xfer;
+			i2c_transfer_start(queue);
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Check for pending transfers
+ *
+ * @param[in] queue transfer queue
+ * @returns true if transfers are running or queued
+ */
+bool i2c_transfer_queue_busy(const struct i2c_transfer_queue *queue)
+{
+	return queue->head != NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Interrupt handler for the transfer queue
+ *
+ * To be called from the I2C event and error interrupts. NACK, arbitration
+ * loss, bus errors, overruns and bus timeouts (if enabled in I2C_TIMEOUTR)
+ * complete the running transfer with the matching error status.
+ *
+ * @param[in] queue transfer queue
+ */
+void i2c_transfer_irq_handler(struct i2c_transfer_queue *queue)
+{
+	struct i2c_transfer *xfer = queue->head;
+	uint32_t i2c = queue->i2c;
+	uint32_t isr = I2C_ISR(i2c);
+
+	if (!xfer) {
+		return;
+	}
+
+	if (isr & (I2C_ISR_ARLO | I2C_ISR_BERR | I2C_ISR_OVR |
+		   I2C_ISR_TIMEOUT)) {
+		I2C_ICR(i2c) = I2C_ICR_ARLOCF | I2C_ICR_BERRCF |
+			       I2C_ICR_OVRCF | I2C_ICR_TIMOUTCF;
+		if (isr & I2C_ISR_ARLO) {
+			i2c_transfer_finish(queue, I2C_TRANSFER_ARLO);
+		} else if (isr & I2C_ISR_TIMEOUT) {
+			i2c_transfer_finish(queue, I2C_TRANSFER_TIMEOUT);
+		} else {
+			i2c_transfer_finish(queue, I2C_TRANSFER_BUS_ERROR);
+		}
+		return;
+	}
+
+	if (isr & I2C_ISR_NACKF) {
+		/* The master sends a STOP by itself, finish on STOPF. */
+		I2C_ICR(i2c) = I2C_ICR_NACKCF;
+		I2C_ISR(i2c) = I2C_ISR_TXE;
+		queue->error = I2C_TRANSFER_NACK;
+	}
+
+	if (isr & I2C_ISR_STOPF) {
+		I2C_ICR(i2c) = I2C_ICR_STOPCF;
+		i2c_transfer_finish(queue, queue->error ? queue->error :
+						I2C_TRANSFER_DONE);
+		return;
+	}
+
+	if (!queue->dma) {
+		if ((isr & I2C_ISR_TXIS) &&
+		    (queue->state == I2C_TRANSFER_WRITE) &&
+		    (queue->pos < xfer->wn)) {
+			I2C_TXDR(i2c) = xfer->w[queue->pos++];
+		}
+		if ((isr & I2C_ISR_RXNE) &&
+		    (queue->state == I2C_TRANSFER_READ) &&
+		    (queue->pos < xfer->rn)) {
+			xfer->r[queue->pos++] = I2C_RXDR(i2c);
+		}
+	}
+
+	if (isr & I2C_ISR_TCR) {
+		I2C_CR2(i2c) = (I2C_CR2(i2c) & ~(I2C_CR2_NBYTES_MASK |
+						 I2C_CR2_RELOAD |
+						 I2C_CR2_AUTOEND)) |
+			       i2c_transfer_next_chunk(queue);
+	} else if ((isr & I2C_ISR_TC) &&
+		   (queue->state == I2C_TRANSFER_WRITE)) {
+		/* Write phase done, repeated start for the read phase. */
+		i2c_disable_txdma(i2c);
+		queue->state = I2C_TRANSFER_READ;
+		i2c_transfer_start_phase(queue);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief I2C Abort the running transfer
+ *
+ * Intended for application level timeouts. The peripheral is reset through
+ * PE, which releases the bus, and the running transfer completes with
+ * I2C_TRANSFER_TIMEOUT. Queued transfers are then started.
+ *
+ * @param[in] queue transfer queue
+ */
+void i2c_transfer_abort(struct i2c_transfer_queue *queue)
+{
+	CM_ATOMIC_BLOCK() {
+		if (queue->head) {
+			i2c_peripheral_disable(queue->i2c);
+			while (I2C_CR1(queue->i2c) & I2C_CR1_PE);
+			i2c_peripheral_enable(queue->i2c);
+			i2c_transfer_finish(queue, I2C_TRANSFER_TIMEOUT);
+		}
+	}
+}
+
 /**@}*/
@@ -26,6 +26,7 @@
  * along with this library. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/stm32/rng.h>
 
 /**@{*/
@@ -118,4 +119,210 @@ uint32_t rng_get_random_blocking(void)
 }
 
 
+/* Health tests of NIST SP 800-90B 4.4 on byte samples, with the cutoffs for
+ * an assumed min-entropy of 4 bits per byte and alpha = 2^-20. */
+#define RNG_RCT_CUTOFF		6
+#define RNG_APT_WINDOW		512
+#define RNG_APT_CUTOFF		62
+/* Restarts without a passed APT window before the source is given up */
+#define RNG_MAX_RESTARTS	3
+
+static void rng_health_reset(struct rng_pool *pool)
+{
+	pool->discard = true;
+	pool->rct_count = 0;
+	pool->apt_index = 0;
+}
+
+/* Seed error recovery as in the reference manuals. */
+static void rng_restart(struct rng_pool *pool)
+{
+	int i;
+
+	RNG_SR = RNG_SR & ~RNG_SR_SEIS;
+	for (i = 12; i != 0; i--) {
+		(void)RNG_DR;
+	}
+	RNG_CR &= ~RNG_CR_RNGEN;
+	if (++pool->restarts > RNG_MAX_RESTARTS) {
+		pool->failed = true;
+		RNG_CR &= ~RNG_CR_IE;
+		return;
+	}
+	RNG_CR |= RNG_CR_RNGEN;
+	rng_health_reset(pool);
+}
+
+static bool rng_health_byte(struct rng_pool *pool, uint8_t b)
+{
+	if (pool->rct_count && b == pool->rct_sample) {
+		if (++pool->rct_count >= RNG_RCT_CUTOFF) {
+			return false;
+		}
+	} else {
+		pool->rct_sample = b;
+		pool->rct_count = 1;
+	}
+
+	if (pool->apt_index == 0) {
+		pool->apt_sample = b;
+		pool->apt_count = 1;
+	} else if (b == pool->apt_sample) {
+		if (++pool->apt_count >= RNG_APT_CUTOFF) {
+			return false;
+		}
+	}
+	if (++pool->apt_index == RNG_APT_WINDOW) {
+		pool->apt_index = 0;
+		pool->restarts = 0;
+	}
+	return true;
+}
+
+/* The first word after enabling is only kept for the comparison with the
+ * next one, as required by the reference manuals (FIPS PUB 140-2). */
+static bool rng_health_word(struct rng_pool *pool, uint32_t word)
+{
+	bool ok = true;
+	int i;
+
+	if (pool->discard) {
+		pool->discard = false;
+		pool->last = word;
+		return false;
+	}
+	if (word == pool->last) {
+		ok = false;
+	}
+	pool->last = word;
+	for (i = 0; ok && i < 4; i++) {
+		ok = rng_health_byte(pool, word >> (8 * i));
+	}
+	if (!ok) {
+		pool->health_failures++;
+		rng_restart(pool);
+	}
+	return ok;
+}
+
+/** Set up an interrupt filled entropy pool.
+ * Enables the RNG and its interrupt; the application enables the RNG
+ * interrupt in the NVIC and calls rng_pool_irq_handler() from it. The words
+ * in the pool have passed the health tests.
+ * @param pool pool to initialise
+ * @param buf storage for the pool
+ * @param size number of words in buf, one of them is kept free
+ */
+void rng_pool_init(struct rng_pool *pool, uint32_t *buf, uint16_t size)
+{
+	pool->buf = buf;
+	pool->size = size;
+	pool->head = 0;
+	pool->tail = 0;
+	pool->failed = false;
+	pool->seed_errors = 0;
+	pool->clock_errors = 0;
+	pool->health_failures = 0;
+	pool->restarts = 0;
+	rng_health_reset(pool);
+
+	RNG_CR |= RNG_CR_RNGEN | RNG_CR_IE;
+}
+
+/** RNG interrupt handler for the entropy pool.
+ * Recovers from seed errors, counts clock errors and stores tested words.
+ * The interrupt is disabled while the pool is full.
+ * @param pool entropy pool
+ */
+void rng_pool_irq_handler(struct rng_pool *pool)
+{
+	uint32_t sr = RNG_SR;
+	uint16_t next;
+	uint32_t word;
+
+	if (sr & RNG_SR_SEIS) {
+		pool->seed_errors++;
+		rng_restart(pool);
+		return;
+	}
+	if (sr & RNG_SR_CEIS) {
+		/* The RNG keeps running once the clock is back in range */
+		RNG_SR = RNG_SR & ~RNG_SR_CEIS;
+		pool->clock_errors++;
+	}
+	if (!(sr & RNG_SR_DRDY) || (sr & RNG_SR_SECS)) {
+		return;
+	}
+
+	next = pool->head + 1;
+	if (next == pool->size) {
+		next = 0;
+	}
+	if (next == pool->tail) {
+		RNG_CR &= ~RNG_CR_IE;
+		return;
+	}
+
+	word = RNG_DR;
+	if (rng_health_word(pool, word)) {
+		pool->buf[pool->head] = word;
+		pool->head = next;
+	}
+}
+
+/** Number of bytes available in the entropy pool.
+ * @param pool entropy pool
+ * @returns bytes that rng_fill() can return without waiting
+ */
+size_t rng_pool_available(const struct rng_pool *pool)
+{
+	uint16_t head = pool->head;
+	uint16_t tail = pool->tail;
+
+	if (head < tail) {
+		head += pool->size;
+	}
+	return 4u * (head - tail);
+}
+
+/** Copy random bytes from the entropy pool.
+ * Never waits for the RNG: returns what the pool holds, the interrupt refills
+ * it in the background. Bytes of a partially used word are dropped.
+ * @param pool entropy pool
+ * @param buf destination
+ * @param len number of bytes wanted
+ * @returns number of bytes copied, 0 if the pool is empty or has failed
+ */
+size_t rng_fill(struct rng_pool *pool, void *buf, size_t len)
+{
+	uint8_t *dst = buf;
+	size_t done = 0;
+	uint16_t tail = pool->tail;
+
+	if (pool->failed) {
+		return 0;
+	}
+
+	while (done < len && tail != pool->head) {
+		uint32_t word = pool->buf[tail];
+		int i;
+
+		pool->buf[tail] = 0;
+		if (++tail == pool->size) {
+			tail = 0;
+		}
+		for (i = 0; i < 4 && done < len; i++) {
+			dst[done++] = word >> (8 * i);
+		}
+	}
+	pool->tail = tail;
+
+	CM_ATOMIC_BLOCK() {
+		if (!pool->failed) {
+			RNG_CR |= RNG_CR_IE;
+		}
+	}
+	return done;
+}
+
 /**@}*/
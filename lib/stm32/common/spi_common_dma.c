@@ -0,0 +1,236 @@
+/** @addtogroup spi_file SPI peripheral API
+ * @ingroup peripheral_apis
+
+DMA driven transfer queue.
+
+Transfers are described by caller owned @ref spi_transfer descriptors which
+are executed back to back by the DMA controller. The chip select pin of each
+transfer is asserted before and released after it, so transfers to several
+devices on the same bus can be queued together.
+
+The application configures and enables the SPI peripheral, routes the DMA
+requests (dma_channel_select() on F2/F4/F7, the channel selection or DMAMUX
+on other families), enables the RX stream/channel interrupt in the NVIC and
+calls spi_transfer_dma_irq_handler() from it.
+
+@note On SPI peripherals with a FIFO, 8-bit frames require the RX FIFO
+threshold to be set to 8 bits.
+
+@note With the Cortex-M7 data cache enabled the buffers are cleaned and
+invalidated around each transfer, receive buffers should be aligned to the 32
+byte cache line and not share it with other data.
+
+Example:
+@code
+	static struct spi_transfer_queue q;
+	static uint8_t cmd[4], resp[4];
+	static struct spi_transfer xfer = {
+		.cs_port = GPIOA, .cs_pin = GPIO4,
+		.tx_buf = cmd, .rx_buf = resp, .len = sizeof(cmd),
+	};
+
+	spi_transfer_queue_init(&q, SPI1, DMA2, DMA_STREAM3, DMA_STREAM0);
+	spi_transfer_submit(&q, &xfer);
+
+	void dma2_stream0_isr(void)
+	{
+		spi_transfer_dma_irq_handler(&q);
+	}
+@endcode
+*/
+
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/scb.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/spi.h>
+#include "dma_common_periph.h"
+
+/**@{*/
+
+static const uint16_t spi_dummy_tx = 0xffff;
+static uint16_t spi_dummy_rx;
+
+static uint8_t spi_frame_width(uint32_t spi)
+{
+#if defined(SPI_CR2_DS_MASK)
+	return ((SPI_CR2(spi) & SPI_CR2_DS_MASK) > SPI_CR2_DS_8BIT) ? 2 : 1;
+#else
+	return (SPI_CR1(spi) & SPI_CR1_DFF) ? 2 : 1;
+#endif
+}
+
+static void spi_transfer_start(struct spi_transfer_queue *queue,
+			       struct spi_transfer *xfer)
+{
+	uint32_t spi = queue->spi;
+	uint32_t dr = (uint32_t)&SPI_DR(spi);
+	uint8_t width = spi_frame_width(spi);
+	uint32_t rx = xfer->rx_buf ? (uint32_t)xfer->rx_buf :
+				     (uint32_t)&spi_dummy_rx;
+	uint32_t tx = xfer->tx_buf ? (uint32_t)xfer->tx_buf :
+				     (uint32_t)&spi_dummy_tx;
+
+	/* Keep the buffers coherent with a Cortex-M7 data cache. */
+	if (xfer->tx_buf) {
+		scb_prepare_dma_tx(xfer->tx_buf, xfer->len * width);
+	}
+	if (xfer->rx_buf) {
+		scb_prepare_dma_rx(xfer->rx_buf, xfer->len * width);
+	}
+
+	/* Drop stale data so that it doesn't shift the received frames. */
+	while (SPI_SR(spi) & SPI_SR_RXNE) {
+		(void)SPI_DR(spi);
+	}
+
+	dma_periph_setup(queue->dma, queue->rx_ch, dr, rx, xfer->len, width,
+			 false, xfer->rx_buf != NULL);
+	dma_enable_transfer_complete_interrupt(queue->dma, queue->rx_ch);
+	dma_enable_transfer_error_interrupt(queue->dma, queue->rx_ch);
+	dma_periph_setup(queue->dma, queue->tx_ch, dr, tx, xfer->len, width,
+			 true, xfer->tx_buf != NULL);
+
+	if (xfer->cs_port) {
+		gpio_clear(xfer->cs_port, xfer->cs_pin);
+	}
+
+	/* RX must be armed before the first frame is clocked out. */
+	spi_enable_rx_dma(spi);
+	dma_periph_enable(queue->dma, queue->rx_ch);
+	dma_periph_enable(queue->dma, queue->tx_ch);
+	spi_enable_tx_dma(spi);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief SPI Initialise a DMA transfer queue
+
+@param[in] queue queue to initialise
+@param[in] spi Unsigned int32. SPI peripheral identifier @ref spi_reg_base.
+@param[in] dma Unsigned int32. DMA controller base address
+@param[in] tx_ch Unsigned int8. DMA stream/channel serving SPI TX
+@param[in] rx_ch Unsigned int8. DMA stream/channel serving SPI RX
+*/
+
+void spi_transfer_queue_init(struct spi_transfer_queue *queue, uint32_t spi,
+			     uint32_t dma, uint8_t tx_ch, uint8_t rx_ch)
+{
+	queue->spi = spi;
+	queue->dma = dma;
+	queue->tx_ch = tx_ch;
+	queue->rx_ch = rx_ch;
+	queue->head = NULL;
+	queue->tail = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief SPI Queue a transfer
+
+The transfer is started immediately if the queue is idle, otherwise it is
+started from the DMA interrupt once the previous transfers are complete.
+
+@param[in] queue transfer queue
+@param[in] xfer transfer descriptor, must stay valid until completed
+*/
+
+void spi_transfer_submit(struct spi_transfer_queue *queue,
+			 struct spi_transfer *xfer)
+{
+	xfer->status = SPI_TRANSFER_PENDING;
+	xfer->next = NULL;
+
+	CM_ATOMIC_BLOCK() {
+		if (queue->head) {
+			queue->tail->next = xfer;
+			queue->tail = xfer;
+		} else {
+			queue->head = xfer;
+			queue->tail = xfer;
+			spi_transfer_start(queue, xfer);
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief SPI Check for pending transfers
+
+@param[in] queue transfer queue
+@returns true if transfers are running or queued
+*/
+
+bool spi_transfer_queue_busy(const struct spi_transfer_queue *queue)
+{
+	return queue->head != NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief SPI DMA interrupt handler for the transfer queue
+
+To be called from the interrupt of the RX DMA stream/channel. Releases the
+chip select of the finished transfer, starts the next queued transfer and
+then calls the completion callback of the finished one.
+
+@param[in] queue transfer queue
+*/
+
+void spi_transfer_dma_irq_handler(struct spi_transfer_queue *queue)
+{
+	struct spi_transfer *xfer = queue->head;
+	bool error = dma_get_interrupt_flag(queue->dma, queue->rx_ch,
+					    DMA_TEIF);
+
+	if (!error && !dma_get_interrupt_flag(queue->dma, queue->rx_ch,
+					      DMA_TCIF)) {
+		return;
+	}
+	dma_clear_interrupt_flags(queue->dma, queue->rx_ch,
+				  DMA_TCIF | DMA_TEIF);
+	if (!xfer) {
+		return;
+	}
+
+	spi_disable_tx_dma(queue->spi);
+	spi_disable_rx_dma(queue->spi);
+	dma_periph_disable(queue->dma, queue->tx_ch);
+	dma_periph_disable(queue->dma, queue->rx_ch);
+	if (xfer->rx_buf) {
+		scb_complete_dma_rx(xfer->rx_buf,
+				    xfer->len * spi_frame_width(queue->spi));
+	}
+
+	while (SPI_SR(queue->spi) & SPI_SR_BSY);
+	if (xfer->cs_port) {
+		gpio_set(xfer->cs_port, xfer->cs_pin);
+	}
+
+	xfer->status = error ? SPI_TRANSFER_ERROR : SPI_TRANSFER_DONE;
+	queue->head = xfer->next;
+	if (queue->head) {
+		spi_transfer_start(queue, queue->head);
+	} else {
+		queue->tail = NULL;
+	}
+
+	if (xfer->callback) {
+		xfer->callback(xfer);
+	}
+}
+
+/**@}*/
@@ -110,6 +110,118 @@ uint8_t spi_read8(uint32_t spi)
 	return SPI_DR8(spi);
 }
 
+/*---------------------------------------------------------------------------*/
+/** @brief SPI Exchange a block of 8 bit frames.
+
+Frames are written to and read from the FIFOs in pairs with 16 bit data
+register accesses (data packing), the RX FIFO threshold being switched to 8
+bits only for a trailing odd frame. No more frames than the RX FIFO can hold
+are ever outstanding, so the transfer can be interrupted without risking an
+overrun. The original RX FIFO threshold is restored on return.
+
+The data size must be set to 8 bits (or less) and the SPI enabled as master.
+
+@param[in] spi Unsigned int32. SPI peripheral identifier @ref spi_reg_base.
+@param[in] tx Frames to send, or NULL to send 0xff.
+@param[out] rx Buffer for the received frames, or NULL to discard them.
+@param[in] len Unsigned int32. Number of frames.
+*/
+
+void spi_xfer8_block(uint32_t spi, const uint8_t *tx, uint8_t *rx,
+		     uint32_t len)
+{
+	uint32_t frxth = SPI_CR2(spi) & SPI_CR2_FRXTH;
+	uint32_t txn = 0;
+	uint32_t rxn = 0;
+	uint16_t data;
+
+	/*
+	 * RXNE needs a full half-word with FRXTH cleared, it is only set while
+	 * a single frame is left to receive.
+	 */
+	if (len < 2) {
+		SPI_CR2(spi) |= SPI_CR2_FRXTH;
+	} else {
+		SPI_CR2(spi) &= ~SPI_CR2_FRXTH;
+	}
+
+	while (rxn < len) {
+		/* Keep at most 4 frames (the RX FIFO depth) in flight. */
+		if ((txn < len) && (SPI_SR(spi) & SPI_SR_TXE)) {
+			if ((len - txn >= 2) && (txn - rxn <= 2)) {
+				data = tx ? (tx[txn] | (tx[txn + 1] << 8)) :
+					    0xffff;
+				SPI_DR16(spi) = data;
+				txn += 2;
+			} else if ((len - txn == 1) && (txn - rxn <= 3)) {
+				SPI_DR8(spi) = tx ? tx[txn] : 0xff;
+				txn++;
+			}
+		}
+
+		if (!(SPI_SR(spi) & SPI_SR_RXNE)) {
+			continue;
+		}
+		if (len - rxn >= 2) {
+			data = SPI_DR16(spi);
+			if (rx) {
+				rx[rxn] = data & 0xff;
+				rx[rxn + 1] = data >> 8;
+			}
+			rxn += 2;
+			if (len - rxn < 2) {
+				SPI_CR2(spi) |= SPI_CR2_FRXTH;
+			}
+		} else {
+			data = SPI_DR8(spi);
+			if (rx) {
+				rx[rxn] = data;
+			}
+			rxn++;
+		}
+	}
+
+	SPI_CR2(spi) = (SPI_CR2(spi) & ~SPI_CR2_FRXTH) | frxth;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief SPI Exchange a block of 9 to 16 bit frames.
+
+The TX FIFO is kept filled up to the RX FIFO depth of two frames and every
+RXNE is serviced with a single half-word read. The RX FIFO threshold is set to
+16 bits, as required for these frame sizes.
+
+@param[in] spi Unsigned int32. SPI peripheral identifier @ref spi_reg_base.
+@param[in] tx Frames to send, or NULL to send 0xffff.
+@param[out] rx Buffer for the received frames, or NULL to discard them.
+@param[in] len Unsigned int32. Number of frames.
+*/
+
+void spi_xfer16_block(uint32_t spi, const uint16_t *tx, uint16_t *rx,
+		      uint32_t len)
+{
+	uint32_t txn = 0;
+	uint32_t rxn = 0;
+	uint16_t data;
+
+	SPI_CR2(spi) &= ~SPI_CR2_FRXTH;
+
+	while (rxn < len) {
+		if ((txn < len) && (txn - rxn < 2) &&
+		    (SPI_SR(spi) & SPI_SR_TXE)) {
+			SPI_DR16(spi) = tx ? tx[txn] : 0xffff;
+			txn++;
+		}
+		if (SPI_SR(spi) & SPI_SR_RXNE) {
+			data = SPI_DR16(spi);
+			if (rx) {
+				rx[rxn] = data;
+			}
+			rxn++;
+		}
+	}
+}
+
 /*---------------------------------------------------------------------------*/
 /** @brief SPI Set CRC length to 8 bits
 
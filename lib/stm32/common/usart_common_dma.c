@@ -0,0 +1,356 @@
+/** @addtogroup usart_file USART peripheral API
+@ingroup peripheral_apis
+
+DMA buffered port.
+
+Reception runs continuously through a circular DMA transfer into an
+application supplied ring. The application is notified through
+usart_buffered::rx_callback when the line goes idle after a frame, on
+the receiver timeout (where available and enabled with
+usart_set_rx_timeout_value() and usart_enable_rx_timeout()) and when the
+ring is half or completely filled. Transmission is queued into a second ring
+and sent by DMA in the background.
+
+The ring sizes must cover the data received while the application does not
+read: the DMA overwrites unread data without notice.
+
+With the Cortex-M7 data cache enabled both rings are cleaned and invalidated
+around the DMA transfers, they should be aligned to the 32 byte cache line.
+
+The application configures the USART and routes the DMA requests, enables
+the USART and both DMA stream/channel interrupts in the NVIC and calls
+usart_buffered_irq_handler(), usart_buffered_rx_dma_irq_handler() and
+usart_buffered_tx_dma_irq_handler() from them.
+*/
+
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**@{*/
+
+#include <stddef.h>
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/scb.h>
+#include <libopencm3/stm32/usart.h>
+#include "dma_common_periph.h"
+
+#if defined(USART_ICR)
+#define USART_BUFFERED_RDR(usart)	USART_RDR(usart)
+#define USART_BUFFERED_TDR(usart)	USART_TDR(usart)
+#else
+#define USART_BUFFERED_RDR(usart)	USART_DR(usart)
+#define USART_BUFFERED_TDR(usart)	USART_DR(usart)
+#endif
+
+static void usart_buffered_tx_start(struct usart_buffered *port)
+{
+	uint16_t head = port->tx_head;
+	uint16_t tail = port->tx_tail;
+	uint16_t len;
+
+	if (head == tail) {
+		port->tx_dma_len = 0;
+		return;
+	}
+
+	/* Send up to the end of the ring, the rest follows on completion. */
+	len = (head > tail) ? (head - tail) : (port->tx_size - tail);
+	port->tx_dma_len = len;
+	scb_prepare_dma_tx(&port->tx_buf[tail], len);
+
+	dma_periph_setup(port->dma, port->tx_ch,
+			 (uint32_t)&USART_BUFFERED_TDR(port->usart),
+			 (uint32_t)&port->tx_buf[tail], len, 1, true, true);
+	dma_enable_transfer_complete_interrupt(port->dma, port->tx_ch);
+	dma_enable_transfer_error_interrupt(port->dma, port->tx_ch);
+	dma_periph_enable(port->dma, port->tx_ch);
+	usart_enable_tx_dma(port->usart);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART Initialise a DMA buffered port
+
+@param[in] port port to initialise
+@param[in] usart unsigned 32 bit. USART block register address base @ref
+usart_reg_base
+@param[in] dma unsigned 32 bit. DMA controller base address
+@param[in] tx_ch unsigned 8 bit. DMA stream/channel serving USART TX
+@param[in] rx_ch unsigned 8 bit. DMA stream/channel serving USART RX
+*/
+
+void usart_buffered_init(struct usart_buffered *port, uint32_t usart,
+			 uint32_t dma, uint8_t tx_ch, uint8_t rx_ch)
+{
+	port->usart = usart;
+	port->dma = dma;
+	port->tx_ch = tx_ch;
+	port->rx_ch = rx_ch;
+	port->rx_buf = NULL;
+	port->rx_size = 0;
+	port->rx_tail = 0;
+	port->tx_buf = NULL;
+	port->tx_size = 0;
+	port->tx_head = 0;
+	port->tx_tail = 0;
+	port->tx_dma_len = 0;
+	port->rx_callback = NULL;
+	port->rx_errors = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART Set the transmit ring of a buffered port
+
+@param[in] port buffered port
+@param[in] buf ring storage, one byte of it is never used
+@param[in] size unsigned 16 bit. Size of buf in bytes
+*/
+
+void usart_buffered_set_tx_buffer(struct usart_buffered *port, uint8_t *buf,
+				  uint16_t size)
+{
+	port->tx_buf = buf;
+	port->tx_size = size;
+	port->tx_head = 0;
+	port->tx_tail = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART Start circular DMA reception of a buffered port
+
+The idle line and error interrupts of the USART and the half and full
+transfer interrupts of the DMA are enabled.
+
+@param[in] port buffered port
+@param[in] buf ring storage
+@param[in] size unsigned 16 bit. Size of buf in bytes
+*/
+
+void usart_buffered_start_rx(struct usart_buffered *port, uint8_t *buf,
+			     uint16_t size)
+{
+	port->rx_buf = buf;
+	port->rx_size = size;
+	port->rx_tail = 0;
+	scb_prepare_dma_rx(buf, size);
+
+	dma_periph_setup(port->dma, port->rx_ch,
+			 (uint32_t)&USART_BUFFERED_RDR(port->usart),
+			 (uint32_t)buf, size, 1, false, true);
+	dma_enable_circular_mode(port->dma, port->rx_ch);
+	dma_enable_half_transfer_interrupt(port->dma, port->rx_ch);
+	dma_enable_transfer_complete_interrupt(port->dma, port->rx_ch);
+	dma_periph_enable(port->dma, port->rx_ch);
+
+	usart_enable_rx_dma(port->usart);
+	usart_enable_idle_interrupt(port->usart);
+	usart_enable_error_interrupt(port->usart);
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART Get the number of received bytes not read yet
+
+@param[in] port buffered port
+@returns number of bytes that usart_buffered_read() can return
+*/
+
+size_t usart_buffered_rx_available(const struct usart_buffered *port)
+{
+	uint16_t head = port->rx_size -
+			dma_get_number_of_data(port->dma, port->rx_ch);
+
+	if (head == port->rx_size) {
+		head = 0;
+	}
+	return (head + port->rx_size - port->rx_tail) % port->rx_size;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART Read received bytes from a buffered port
+
+@param[in] port buffered port
+@param[out] data destination
+@param[in] len maximum number of bytes to read
+@returns number of bytes read
+*/
+
+size_t usart_buffered_read(struct usart_buffered *port, uint8_t *data,
+			   size_t len)
+{
+	size_t avail = usart_buffered_rx_available(port);
+	size_t i;
+
+	if (len > avail) {
+		len = avail;
+	}
+	/* The DMA writes the ring behind a Cortex-M7 data cache. */
+	scb_complete_dma_rx(port->rx_buf, port->rx_size);
+	for (i = 0; i < len; i++) {
+		data[i] = port->rx_buf[port->rx_tail];
+		if (++port->rx_tail == port->rx_size) {
+			port->rx_tail = 0;
+		}
+	}
+	return len;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART Queue bytes for transmission on a buffered port
+
+As many bytes as fit into the transmit ring are queued, the DMA is started if
+it is idle.
+
+@param[in] port buffered port
+@param[in] data bytes to send
+@param[in] len number of bytes
+@returns number of bytes queued
+*/
+
+size_t usart_buffered_write(struct usart_buffered *port, const uint8_t *data,
+			    size_t len)
+{
+	uint16_t head = port->tx_head;
+	uint16_t room = (port->tx_tail + port->tx_size - head - 1) %
+			port->tx_size;
+	size_t i;
+
+	if (len > room) {
+		len = room;
+	}
+	for (i = 0; i < len; i++) {
+		port->tx_buf[head] = data[i];
+		if (++head == port->tx_size) {
+			head = 0;
+		}
+	}
+
+	CM_ATOMIC_BLOCK() {
+		port->tx_head = head;
+		if (!port->tx_dma_len) {
+			usart_buffered_tx_start(port);
+		}
+	}
+	return len;
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART Check for queued transmit data
+
+@param[in] port buffered port
+@returns true if queued bytes have not all been handed to the USART yet
+*/
+
+bool usart_buffered_tx_busy(const struct usart_buffered *port)
+{
+	return port->tx_dma_len != 0;
+}
+
+static void usart_buffered_notify(struct usart_buffered *port)
+{
+	size_t avail = usart_buffered_rx_available(port);
+
+	if (port->rx_callback && avail) {
+		port->rx_callback(port, avail);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART Interrupt handler of a buffered port
+
+Handles the idle line and receiver timeout events and counts receive errors.
+
+@param[in] port buffered port
+*/
+
+void usart_buffered_irq_handler(struct usart_buffered *port)
+{
+	uint32_t usart = port->usart;
+#if defined(USART_ICR)
+	uint32_t isr = USART_ISR(usart);
+	uint32_t events = USART_ISR_IDLE;
+
+#if defined(USART_ISR_RTOF)
+	events |= USART_ISR_RTOF;
+#endif
+	if (isr & (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NF |
+		   USART_ISR_PE)) {
+		port->rx_errors++;
+	}
+	USART_ICR(usart) = isr & (events | USART_ICR_ORECF | USART_ICR_FECF |
+				  USART_ICR_NCF | USART_ICR_PECF);
+#else
+	uint32_t isr = USART_SR(usart);
+	uint32_t events = USART_SR_IDLE;
+
+	if (isr & (USART_SR_ORE | USART_SR_FE | USART_SR_NE | USART_SR_PE)) {
+		port->rx_errors++;
+	}
+	if (isr & (events | USART_SR_ORE | USART_SR_FE | USART_SR_NE |
+		   USART_SR_PE)) {
+		/* SR then DR read sequence clears these flags. */
+		(void)USART_DR(usart);
+	}
+#endif
+
+	if (isr & events) {
+		usart_buffered_notify(port);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART RX DMA interrupt handler of a buffered port
+
+@param[in] port buffered port
+*/
+
+void usart_buffered_rx_dma_irq_handler(struct usart_buffered *port)
+{
+	if (dma_get_interrupt_flag(port->dma, port->rx_ch,
+				   DMA_HTIF | DMA_TCIF)) {
+		dma_clear_interrupt_flags(port->dma, port->rx_ch,
+					  DMA_HTIF | DMA_TCIF);
+		usart_buffered_notify(port);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/** @brief USART TX DMA interrupt handler of a buffered port
+
+Releases the sent part of the transmit ring and starts the next one.
+
+@param[in] port buffered port
+*/
+
+void usart_buffered_tx_dma_irq_handler(struct usart_buffered *port)
+{
+	uint16_t tail;
+
+	if (!dma_get_interrupt_flag(port->dma, port->tx_ch,
+				    DMA_TCIF | DMA_TEIF)) {
+		return;
+	}
+	dma_clear_interrupt_flags(port->dma, port->tx_ch, DMA_TCIF | DMA_TEIF);
+	dma_periph_disable(port->dma, port->tx_ch);
+
+	tail = port->tx_tail + port->tx_dma_len;
+	if (tail >= port->tx_size) {
+		tail -= port->tx_size;
+	}
+	port->tx_tail = tail;
+	usart_buffered_tx_start(port);
+}
+
+/**@}*/
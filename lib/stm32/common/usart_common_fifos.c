@@ -15,6 +15,7 @@
  * along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/stm32/usart.h>
 
 void usart_enable_fifos(uint32_t usart) {
@@ -70,3 +71,132 @@ void usart_set_rx_fifo_threshold(uint32_t usart,
 		       ~(USART_FIFO_THRESH_MASK << USART_CR3_RXFTCFG_SHIFT);
 	USART_CR3(usart) = cr3 | (threshold << USART_CR3_RXFTCFG_SHIFT);
 }
+
+size_t usart_send_fifo(uint32_t usart, const uint8_t *data, size_t len) {
+	size_t i;
+
+	for (i = 0; (i < len) && (USART_ISR(usart) & USART_ISR_TXFNF); i++) {
+		USART_TDR(usart) = data[i];
+	}
+	return i;
+}
+
+size_t usart_recv_fifo(uint32_t usart, uint8_t *data, size_t len) {
+	size_t i;
+
+	for (i = 0; (i < len) && (USART_ISR(usart) & USART_ISR_RXFNE); i++) {
+		data[i] = USART_RDR(usart);
+	}
+	return i;
+}
+
+void usart_fifo_port_init(struct usart_fifo_port *port, uint32_t usart,
+			  uint8_t *rx_buf, uint16_t rx_size,
+			  uint8_t *tx_buf, uint16_t tx_size) {
+	uint32_t ue;
+
+	port->usart = usart;
+	port->rx_buf = rx_buf;
+	port->rx_size = rx_size;
+	port->rx_head = 0;
+	port->rx_tail = 0;
+	port->tx_buf = tx_buf;
+	port->tx_size = tx_size;
+	port->tx_head = 0;
+	port->tx_tail = 0;
+	port->rx_overruns = 0;
+
+	/* FIFOEN can only be changed while the USART is disabled. */
+	ue = USART_CR1(usart) & USART_CR1_UE;
+	if (ue) {
+		while (!(USART_ISR(usart) & USART_ISR_TC));
+		usart_disable(usart);
+	}
+	usart_enable_fifos(usart);
+	usart_set_rx_fifo_threshold(usart, USART_FIFO_THRESH_THREEQTR);
+	usart_set_tx_fifo_threshold(usart, USART_FIFO_THRESH_HALF);
+	if (ue) {
+		usart_enable(usart);
+	}
+	usart_enable_rx_fifo_threshold_interrupt(usart);
+	/* Picks up the bytes left below the RX threshold after a burst. */
+	usart_enable_idle_interrupt(usart);
+}
+
+size_t usart_fifo_port_read(struct usart_fifo_port *port, uint8_t *data,
+			    size_t len) {
+	uint16_t tail = port->rx_tail;
+	size_t i;
+
+	for (i = 0; (i < len) && (tail != port->rx_head); i++) {
+		data[i] = port->rx_buf[tail];
+		if (++tail == port->rx_size) {
+			tail = 0;
+		}
+	}
+	port->rx_tail = tail;
+	return i;
+}
+
+size_t usart_fifo_port_write(struct usart_fifo_port *port,
+			     const uint8_t *data, size_t len) {
+	uint16_t head = port->tx_head;
+	uint16_t next;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		next = (head + 1 == port->tx_size) ? 0 : head + 1;
+		if (next == port->tx_tail) {
+			break;
+		}
+		port->tx_buf[head] = data[i];
+		head = next;
+	}
+
+	CM_ATOMIC_BLOCK() {
+		port->tx_head = head;
+		/* Fires right away if the TX FIFO is below the threshold. */
+		usart_enable_tx_fifo_threshold_interrupt(port->usart);
+	}
+	return i;
+}
+
+void usart_fifo_port_irq_handler(struct usart_fifo_port *port) {
+	uint32_t usart = port->usart;
+	uint32_t isr = USART_ISR(usart);
+	uint16_t head = port->rx_head;
+	uint16_t tail = port->tx_tail;
+	uint16_t next;
+
+	USART_ICR(usart) = isr & (USART_ICR_IDLECF | USART_ICR_ORECF);
+
+	/* Drain the whole RX FIFO, not just the threshold amount. */
+	while (USART_ISR(usart) & USART_ISR_RXFNE) {
+		uint8_t c = USART_RDR(usart);
+
+		next = (head + 1 == port->rx_size) ? 0 : head + 1;
+		if (next == port->rx_tail) {
+			port->rx_overruns++;
+			continue;
+		}
+		port->rx_buf[head] = c;
+		head = next;
+	}
+	port->rx_head = head;
+
+	if (!(USART_CR3(usart) & USART_CR3_TXFTIE)) {
+		return;
+	}
+	/* Refill the TX FIFO up to full. */
+	while ((tail != port->tx_head) &&
+	       (USART_ISR(usart) & USART_ISR_TXFNF)) {
+		USART_TDR(usart) = port->tx_buf[tail];
+		if (++tail == port->tx_size) {
+			tail = 0;
+		}
+	}
+	port->tx_tail = tail;
+	if (tail == port->tx_head) {
+		usart_disable_tx_fifo_threshold_interrupt(usart);
+	}
+}
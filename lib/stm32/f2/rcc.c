@@ -366,8 +366,10 @@ void rcc_clock_setup_hse_3v3(const struct rcc_clock_scale *clock)
 	rcc_osc_on(RCC_PLL);
 	rcc_wait_for_osc_ready(RCC_PLL);
 
-	/* Configure flash settings. */
-	flash_set_ws(clock->flash_config);
+	/* Configure flash settings, keeping the prefetch setting. */
+	flash_set_cache_policy(clock->flash_config & FLASH_ACR_LATENCY_MASK,
+			       clock->flash_config |
+			       (FLASH_ACR & FLASH_ACR_PRFTEN));
 
 	/* Select PLL as SYSCLK source. */
 	rcc_set_sysclk_source(RCC_CFGR_SW_PLL);
@@ -49,7 +49,7 @@
 
 #include <libopencm3/stm32/flash.h>
 
-void flash_wait_for_last_operation(void)
+FLASH_RAMFUNC void flash_wait_for_last_operation(void)
 {
 	while ((FLASH_SR & FLASH_SR_BSY) == FLASH_SR_BSY);
 }
@@ -49,6 +49,11 @@ uint32_t rcc_ahb_frequency = 16000000;
 uint32_t rcc_apb1_frequency = 16000000;
 uint32_t rcc_apb2_frequency = 16000000;
 
+#define RCC_CLOCK_LISTENERS_MAX	8
+
+static rcc_clock_listener rcc_clock_listeners[RCC_CLOCK_LISTENERS_MAX];
+static const struct rcc_clock_scale *rcc_clock_active;
+
 const struct rcc_clock_scale rcc_hsi_configs[RCC_CLOCK_3V3_END] = {
 	{ /* 84MHz */
 		.pllm = 16,
@@ -778,6 +783,142 @@ uint32_t rcc_system_clock_source(void)
 	return (RCC_CFGR & 0x000c) >> 2;
 }
 
+/* Smallest APB prescaler keeping the bus at or below max. */
+static uint8_t rcc_solve_ppre(uint32_t hclk, uint32_t max, uint32_t *freq)
+{
+	uint8_t ppre = RCC_CFGR_PPRE_NODIV;
+	uint32_t div = 1;
+
+	while (hclk / div > max && ppre != RCC_CFGR_PPRE_DIV16) {
+		ppre = (ppre == RCC_CFGR_PPRE_NODIV) ? RCC_CFGR_PPRE_DIV2
+						     : ppre + 1;
+		div *= 2;
+	}
+	*freq = hclk / div;
+	return ppre;
+}
+
+/**
+ * Calculate a PLL clock configuration.
+ *
+ * Searches the main PLL settings giving the highest SYSCLK not above the
+ * requested one, with a VCO input of 1-2MHz (the highest possible, for the
+ * lowest jitter) and a VCO output of 100-432MHz. If USB is needed the VCO is
+ * restricted to an exact multiple of 48MHz, otherwise PLLQ only keeps the 48MHz
+ * clock within its limit. AHB runs at SYSCLK, APB2 is kept at or below 84MHz
+ * (90MHz above 168MHz SYSCLK) and APB1 at or below half of that, which is
+ * safe on all F4 parts. The flash wait states follow the supply voltage range,
+ * instruction and data caches are enabled.
+ *
+ * The result can be passed to rcc_clock_setup_pll(). No registers are touched,
+ * so it can also be calculated once and kept, like the predefined tables.
+ *
+ * @code
+ *	struct rcc_clock_scale clock;
+ *
+ *	if (rcc_clock_scale_solve(&clock, 26000000, 168000000, true,
+ *				  PWR_SCALE1, 3300)) {
+ *		rcc_clock_setup_pll(&clock);
+ *	}
+ * @endcode
+ *
+ * @param[out] clock clock information structure to fill in
+ * @param[in] hse_frequency HSE frequency in Hz, 0 to use the HSI
+ * @param[in] sysclk_frequency maximum SYSCLK frequency in Hz
+ * @param[in] usb48 true if an exact 48MHz clock for USB/SDIO/RNG is needed
+ * @param[in] voltage_scale regulator voltage scale, must allow the SYSCLK
+ * @param[in] vdd_mv supply voltage in mV, for the flash wait states
+ * @returns false if no configuration exists
+ */
+bool rcc_clock_scale_solve(struct rcc_clock_scale *clock,
+			   uint32_t hse_frequency, uint32_t sysclk_frequency,
+			   bool usb48, enum pwr_vos_scale voltage_scale,
+			   uint32_t vdd_mv)
+{
+	uint32_t src = hse_frequency ? hse_frequency : 16000000;
+	uint32_t best = 0;
+	uint32_t m, n, p, q, ws_step, ws;
+
+	for (m = 2; m <= 63; m++) {
+		/* VCO input between 0.95MHz and 2.1MHz */
+		if (src > 2100000 * m) {
+			continue;
+		}
+		if (src < 950000 * m) {
+			break;
+		}
+		for (p = 2; p <= 8; p += 2) {
+			uint64_t nmax = (uint64_t)sysclk_frequency * p * m / src;
+
+			for (n = (nmax > 432) ? 432 : nmax; n >= 50; n--) {
+				uint64_t vco = (uint64_t)src * n;
+				uint64_t mhz48 = 48000000ULL * m;
+				uint32_t f = vco / (m * p);
+
+				if (f <= best || vco < 100000000ULL * m) {
+					break;
+				}
+				if (vco > 432000000ULL * m) {
+					continue;
+				}
+				if (usb48) {
+					if (vco % mhz48) {
+						continue;
+					}
+					q = vco / mhz48;
+					if (q < 2 || q > 15) {
+						continue;
+					}
+				} else {
+					q = (vco + mhz48 - 1) / mhz48;
+					q = (q < 2) ? 2 : q;
+				}
+
+				best = f;
+				clock->pllm = m;
+				clock->plln = n;
+				clock->pllp = p;
+				clock->pllq = q;
+				break;
+			}
+		}
+	}
+	if (!best) {
+		return false;
+	}
+
+	clock->pllr = 0;
+	clock->pll_source = hse_frequency ? RCC_CFGR_PLLSRC_HSE_CLK
+					  : RCC_CFGR_PLLSRC_HSI_CLK;
+	clock->voltage_scale = voltage_scale;
+	clock->hpre = RCC_CFGR_HPRE_NODIV;
+	clock->ahb_frequency = best;
+	clock->ppre2 = rcc_solve_ppre(best, (best > 168000000) ? 90000000
+							       : 84000000,
+				      &clock->apb2_frequency);
+	clock->ppre1 = rcc_solve_ppre(best, (best > 168000000) ? 45000000
+							       : 42000000,
+				      &clock->apb1_frequency);
+
+	/* HCLK per wait state, RM0090 table 10 */
+	if (vdd_mv >= 2700) {
+		ws_step = 30000000;
+	} else if (vdd_mv >= 2400) {
+		ws_step = 24000000;
+	} else if (vdd_mv >= 2100) {
+		ws_step = 22000000;
+	} else {
+		ws_step = 20000000;
+	}
+	ws = (best - 1) / ws_step;
+	if (ws > FLASH_ACR_LATENCY_MASK) {
+		return false;
+	}
+	clock->flash_config = FLASH_ACR_DCEN | FLASH_ACR_ICEN |
+			      FLASH_ACR_LATENCY(ws);
+	return true;
+}
+
 /**
  * Setup clocks to run from PLL.
  *
@@ -792,8 +933,12 @@ void rcc_clock_setup_pll(const struct rcc_clock_scale *clock)
 	rcc_osc_on(RCC_HSI);
 	rcc_wait_for_osc_ready(RCC_HSI);
 
-	/* Select HSI as SYSCLK source. */
+	/*
+	 * Select HSI as SYSCLK source. The PLL can't be stopped while it
+	 * still clocks the system, wait for the switch.
+	 */
 	rcc_set_sysclk_source(RCC_CFGR_SW_HSI);
+	rcc_wait_for_sysclk_status(RCC_HSI);
 
 	/* Enable external high-speed oscillator (HSE). */
 	if (clock->pll_source == RCC_CFGR_PLLSRC_HSE_CLK) {
@@ -801,6 +946,12 @@ void rcc_clock_setup_pll(const struct rcc_clock_scale *clock)
 		rcc_wait_for_osc_ready(RCC_HSE);
 	}
 
+	/*
+	 * Disable PLL oscillator before changing its configuration. The VOS
+	 * scale can only be changed with the PLL off on some parts.
+	 */
+	rcc_osc_off(RCC_PLL);
+
 	/* Set the VOS scale mode */
 	rcc_periph_clock_enable(RCC_PWR);
 	pwr_set_vos_scale(clock->voltage_scale);
@@ -813,9 +964,6 @@ void rcc_clock_setup_pll(const struct rcc_clock_scale *clock)
 	rcc_set_ppre1(clock->ppre1);
 	rcc_set_ppre2(clock->ppre2);
 
-	/* Disable PLL oscillator before changing its configuration. */
-	rcc_osc_off(RCC_PLL);
-
 	/* Configure the PLL oscillator. */
 	if (clock->pll_source == RCC_CFGR_PLLSRC_HSE_CLK) {
 		rcc_set_main_pll_hse(clock->pllm, clock->plln,
@@ -829,18 +977,10 @@ void rcc_clock_setup_pll(const struct rcc_clock_scale *clock)
 	rcc_osc_on(RCC_PLL);
 	rcc_wait_for_osc_ready(RCC_PLL);
 
-	/* Configure flash settings. */
-	if (clock->flash_config & FLASH_ACR_DCEN) {
-		flash_dcache_enable();
-	} else {
-		flash_dcache_disable();
-	}
-	if (clock->flash_config & FLASH_ACR_ICEN) {
-		flash_icache_enable();
-	} else {
-		flash_icache_disable();
-	}
-	flash_set_ws(clock->flash_config);
+	/* Configure flash settings, keeping the prefetch setting. */
+	flash_set_cache_policy(clock->flash_config & FLASH_ACR_LATENCY_MASK,
+			       clock->flash_config |
+			       (FLASH_ACR & FLASH_ACR_PRFTEN));
 
 	/* Select PLL as SYSCLK source. */
 	rcc_set_sysclk_source(RCC_CFGR_SW_PLL);
@@ -852,6 +992,7 @@ void rcc_clock_setup_pll(const struct rcc_clock_scale *clock)
 	rcc_ahb_frequency  = clock->ahb_frequency;
 	rcc_apb1_frequency = clock->apb1_frequency;
 	rcc_apb2_frequency = clock->apb2_frequency;
+	rcc_clock_active = clock;
 
 	/* Disable internal high-speed oscillator. */
 	if (clock->pll_source == RCC_CFGR_PLLSRC_HSE_CLK) {
@@ -859,6 +1000,94 @@ void rcc_clock_setup_pll(const struct rcc_clock_scale *clock)
 	}
 }
 
+static void rcc_clock_notify(enum rcc_clock_change event)
+{
+	int i;
+
+	for (i = 0; i < RCC_CLOCK_LISTENERS_MAX; i++) {
+		if (rcc_clock_listeners[i]) {
+			rcc_clock_listeners[i](event);
+		}
+	}
+}
+
+/**
+ * Register a clock change listener.
+ *
+ * Listeners are called by rcc_clock_switch() with RCC_CLOCK_CHANGE_PRE before
+ * the clocks change, to finish or pause transfers, and with
+ * RCC_CLOCK_CHANGE_POST once the new frequencies are set, to reprogram baud
+ * rates, timer prescalers, I2C timings or the systick reload value. In
+ * between the system runs from the HSI for the PLL lock time.
+ *
+ * @param listener function to call, registering it twice has no effect
+ * @returns 0 on success, -1 if all RCC_CLOCK_LISTENERS_MAX slots are used
+ */
+int rcc_clock_listener_register(rcc_clock_listener listener)
+{
+	int i;
+
+	for (i = 0; i < RCC_CLOCK_LISTENERS_MAX; i++) {
+		if (rcc_clock_listeners[i]) {
+			if (rcc_clock_listeners[i] == listener) {
+				return 0;
+			}
+			continue;
+		}
+
+		rcc_clock_listeners[i] = listener;
+		return 0;
+	}
+
+	return -1;
+}
+
+/**
+ * Unregister a clock change listener.
+ *
+ * @param listener function passed to rcc_clock_listener_register()
+ */
+void rcc_clock_listener_unregister(rcc_clock_listener listener)
+{
+	int i;
+
+	for (i = 0; i < RCC_CLOCK_LISTENERS_MAX; i++) {
+		if (rcc_clock_listeners[i] == listener) {
+			rcc_clock_listeners[i] = NULL;
+		}
+	}
+}
+
+/**
+ * Switch to another operating point.
+ *
+ * Reconfigures the clocks with rcc_clock_setup_pll() and notifies the
+ * registered listeners before and after. The voltage scale, prescalers and
+ * flash wait states are changed while the system runs from the HSI, so they
+ * are valid for both the old and the new frequency whether it goes up or
+ * down. Switching to the operating point already in use does nothing.
+ *
+ * @code
+ *	rcc_clock_listener_register(uart_clock_changed);
+ *	...
+ *	rcc_clock_switch(&rcc_hse_8mhz_3v3[RCC_CLOCK_3V3_84MHZ]);	// idle
+ *	...
+ *	rcc_clock_switch(&rcc_hse_8mhz_3v3[RCC_CLOCK_3V3_168MHZ]);	// busy
+ * @endcode
+ *
+ * @param clock operating point, must stay valid while it is in use
+ */
+void rcc_clock_switch(const struct rcc_clock_scale *clock)
+{
+	if (clock == rcc_clock_active) {
+		return;
+	}
+
+	rcc_clock_notify(RCC_CLOCK_CHANGE_PRE);
+	rcc_clock_setup_pll(clock);
+	rcc_clock_notify(RCC_CLOCK_CHANGE_POST);
+}
+
 /**
  * Setup clocks with the HSE.
  *
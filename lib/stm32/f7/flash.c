@@ -39,7 +39,7 @@ completion of a previous data write operation.
 
 */
 
-static inline void flash_pipeline_stall(void)
+static inline FLASH_RAMFUNC void flash_pipeline_stall(void)
 {
 	__asm__ volatile("dsb":::"memory");
 }
@@ -50,7 +50,7 @@ static inline void flash_pipeline_stall(void)
 This loops indefinitely until an operation (write or erase) has completed by
 testing the busy flag.
 */
-void flash_wait_for_last_operation(void)
+FLASH_RAMFUNC void flash_wait_for_last_operation(void)
 {
 	flash_pipeline_stall();
 	while ((FLASH_SR & FLASH_SR_BSY) == FLASH_SR_BSY);
@@ -103,4 +103,35 @@ void flash_art_reset(void)
 	FLASH_ACR |= FLASH_ACR_ARTRST;
 }
 
+/*---------------------------------------------------------------------------*/
+/** @brief Set the Wait States and Accelerator Policy
+
+The ART cache is disabled and reset before the latency changes and enabled
+again once the new latency is effective.
+
+@param[in] ws number of wait states
+@param[in] policy any of FLASH_ACR_PRFTEN, FLASH_ACR_ARTEN, other bits are
+ignored
+*/
+
+void flash_set_cache_policy(uint32_t ws, uint32_t policy)
+{
+	uint32_t reg32 = FLASH_ACR & ~FLASH_ACR_ARTEN;
+
+	FLASH_ACR = reg32;
+	FLASH_ACR = reg32 | FLASH_ACR_ARTRST;
+
+	reg32 &= ~(FLASH_ACR_PRFTEN |
+		   (FLASH_ACR_LATENCY_MASK << FLASH_ACR_LATENCY_SHIFT));
+	reg32 |= (ws & FLASH_ACR_LATENCY_MASK) << FLASH_ACR_LATENCY_SHIFT;
+	reg32 |= policy & FLASH_ACR_PRFTEN;
+	FLASH_ACR = reg32;
+
+	/* The new latency is in use once it reads back. */
+	while (((FLASH_ACR >> FLASH_ACR_LATENCY_SHIFT) &
+		FLASH_ACR_LATENCY_MASK) != (ws & FLASH_ACR_LATENCY_MASK));
+
+	FLASH_ACR = reg32 | (policy & FLASH_ACR_ARTEN);
+}
+
 /**@}*/
@@ -415,9 +415,8 @@ void rcc_clock_setup_hse(const struct rcc_clock_scale *clock, uint32_t hse_mhz)
 	rcc_wait_for_osc_ready(RCC_PLL);
 
 	/* Configure flash settings. */
-	flash_set_ws(clock->flash_waitstates);
-	flash_art_enable();
-	flash_prefetch_enable();
+	flash_set_cache_policy(clock->flash_waitstates,
+			       FLASH_ACR_ARTEN | FLASH_ACR_PRFTEN);
 
 	/* Select PLL as SYSCLK source. */
 	rcc_set_sysclk_source(RCC_CFGR_SW_PLL);
@@ -468,9 +467,8 @@ void rcc_clock_setup_hsi(const struct rcc_clock_scale *clock)
 	rcc_wait_for_osc_ready(RCC_PLL);
 
 	/* Configure flash settings. */
-	flash_set_ws(clock->flash_waitstates);
-	flash_art_enable();
-	flash_prefetch_enable();
+	flash_set_cache_policy(clock->flash_waitstates,
+			       FLASH_ACR_ARTEN | FLASH_ACR_PRFTEN);
 
 	/* Select PLL as SYSCLK source. */
 	rcc_set_sysclk_source(RCC_CFGR_SW_PLL);
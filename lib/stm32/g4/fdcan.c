@@ -64,6 +64,20 @@ unsigned fdcan_get_fifo_element_size(uint32_t canport, unsigned fifo_id)
 	return sizeof(struct fdcan_rx_fifo_element);
 }
 
+/** Returns amount of elements in receive FIFO for given CAN port and FIFO.
+ *
+ * For G4 it returns constant value as G4 has FIFO depth hardcoded.
+ * @param [in] canport FDCAN block base address. See @ref fdcan_block. Unused.
+ * @param [in] fifo_id ID of FIFO whose depth is queried. Unused.
+ * @returns Amount of elements in receive FIFO.
+ */
+unsigned fdcan_get_fifo_depth(uint32_t canport, unsigned fifo_id)
+{
+	(void) (canport);
+	(void) (fifo_id);
+	return 3;
+}
+
 /** Returns actual size of transmit entry in transmit queue/FIFO for given CAN port.
  *
  * Obtains value of entry length in transmit queue/FIFO. For G4 it returns constant value
@@ -135,6 +149,40 @@ void fdcan_init_filter(uint32_t canport, uint8_t std_filt, uint8_t ext_filt)
 	}
 }
 
+/** Configure partitioning of message RAM.
+ *
+ * Message RAM layout of G4 is fixed except of amount of filter rules. This
+ * function checks, that requested layout fits into the fixed one and then
+ * configures amount of filters using @ref fdcan_init_filter. It is provided
+ * for source level compatibility with code written for STM32H7. Same
+ * restrictions as for @ref fdcan_init_filter apply.
+ *
+ * @param [in] canport FDCAN block base address. See @ref fdcan_block.
+ * @param [in] offset Unused, position of each block's area is fixed.
+ * @param [in] layout Requested layout. Payload sizes are ignored, all
+ *				elements can hold 64 bytes.
+ * @returns Amount of message RAM used by the block in bytes, or
+ * FDCAN_E_OUTOFRANGE if layout cannot be provided.
+ */
+int fdcan_set_ram_layout(uint32_t canport, uint32_t offset,
+		const struct fdcan_ram_layout *layout)
+{
+	(void) (offset);
+
+	if (layout->std_filters > FDCAN_SFT_MAX_NR
+		|| layout->ext_filters > FDCAN_EFT_MAX_NR
+		|| layout->rx_fifo0 > 3 || layout->rx_fifo1 > 3
+		|| layout->tx_events > 3 || layout->tx_fifo > 3
+		|| layout->rx_buffers != 0 || layout->tx_buffers != 0) {
+		return FDCAN_E_OUTOFRANGE;
+	}
+
+	fdcan_init_filter(canport, layout->std_filters, layout->ext_filters);
+
+	return FDCAN_TXBUF_OFFSET(canport) - FDCAN_LFSSA_OFFSET(canport)
+		+ 3 * sizeof(struct fdcan_tx_buffer_element);
+}
+
 /** Enable FDCAN operation after FDCAN block has been set up.
  *
  * This function will disable FDCAN configuration effectively
@@ -43,6 +43,7 @@
 /**@{*/
 
 #include <libopencm3/stm32/flash.h>
+#include "../common/flash_common_load.h"
 
 /** @brief Wait until Last Operation has Ended
  * This loops indefinitely until an operation (write or erase) has completed
@@ -143,13 +144,14 @@ void flash_program_double_word(uint32_t address, uint64_t data)
  * The program error flag should be checked separately for the event that
  * memory was not properly erased.
  * @param[in] address Starting address in Flash.
- * @param[in] data Pointer to start of data block.
+ * @param[in] data Pointer to start of data block, of any alignment.
  * @param[in] len Length of data block in bytes (multiple of 8).
  */
 void flash_program(uint32_t address, uint8_t *data, uint32_t len)
 {
 	for (uint32_t i = 0; i < len; i += 8) {
-		flash_program_double_word(address+i, *(uint64_t*)(data + i));
+		flash_program_double_word(address + i,
+					  flash_load_double_word(data + i));
 	}
 }
 
@@ -707,18 +707,9 @@ void rcc_clock_setup_pll(const struct rcc_clock_scale *clock)
 	rcc_osc_on(RCC_PLL);
 	rcc_wait_for_osc_ready(RCC_PLL);
 
-	/* Configure flash settings. */
-	if (clock->flash_config & FLASH_ACR_DCEN) {
-		flash_dcache_enable();
-	} else {
-		flash_dcache_disable();
-	}
-	if (clock->flash_config & FLASH_ACR_ICEN) {
-		flash_icache_enable();
-	} else {
-		flash_icache_disable();
-	}
-	flash_set_ws(clock->flash_waitstates);
+	/* Configure flash settings, keeping the prefetch setting. */
+	flash_set_cache_policy(clock->flash_waitstates, clock->flash_config |
+			       (FLASH_ACR & FLASH_ACR_PRFTEN));
 
 	/* Select PLL as SYSCLK source. */
 	rcc_set_sysclk_source(RCC_CFGR_SWx_PLL);
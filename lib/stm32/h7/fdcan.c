@@ -82,6 +82,17 @@ unsigned fdcan_get_fifo_element_size(uint32_t canport, unsigned fifo_id)
 	return 8 + fdcan_dlc_to_length((element_size & FDCAN_RXESC_F0DS_MASK) | 0x8);
 }
 
+/** Returns amount of elements in receive FIFO for given CAN port and FIFO.
+ *
+ * @param [in] canport FDCAN block base address. See @ref fdcan_block.
+ * @param [in] fifo_id ID of FIFO whose depth is queried.
+ * @returns Amount of elements in receive FIFO.
+ */
+unsigned fdcan_get_fifo_depth(uint32_t canport, unsigned fifo_id)
+{
+	return (FDCAN_RXFIC(canport, fifo_id) >> FDCAN_RXFIC_FIS_SHIFT) & FDCAN_RXFIC_FIS_MASK;
+}
+
 /** Returns actual size of transmit entry in transmit queue/FIFO for given CAN port.
  *
  * Obtains value of entry length in transmit queue/FIFO. This value covers both
@@ -277,6 +288,115 @@ int fdcan_set_tx_element_size(uint32_t canport, uint8_t txbuf)
 	return FDCAN_E_OK;
 }
 
+/** Returns size of message RAM element holding given payload size.
+ *
+ * @param [in] length payload size, padded to 8 bytes if smaller
+ * @returns element size in bytes, 0 if length is not valid FDCAN frame length
+ */
+static unsigned fdcan_ram_element_size(uint8_t length)
+{
+	if (fdcan_length_to_dlc(length) == 0xFF) {
+		return 0;
+	}
+
+	return 8 + ((length < 8) ? 8 : length);
+}
+
+/** Configure partitioning of message RAM.
+ *
+ * Allocates all message RAM objects of one FDCAN block as one contiguous
+ * area starting at given offset in order FLSSA < FLESA < F0SA < F1SA < RBSA
+ * < EFSA < TBSA and clears all filter rules. Transmit buffer area holds
+ * dedicated transmit buffers followed by transmit FIFO/queue. Message RAM
+ * is shared between FDCAN blocks, so area of second block shall start at
+ * offset where area of first block ends. Element payload sizes are configured
+ * too. This function can only be called while FDCAN block is in INIT mode.
+ * Calling it replaces layout configured by @ref fdcan_init_filter and
+ * the default layout set up by @ref fdcan_start.
+ *
+ * @param [in] canport FDCAN block base address. See @ref fdcan_block.
+ * @param [in] offset start of area in message RAM in bytes, multiple of 4
+ * @param [in] layout requested layout
+ * @returns Amount of message RAM used by the block in bytes, or
+ * FDCAN_E_INVALID if payload size is invalid, or FDCAN_E_OUTOFRANGE if
+ * element counts are out of range or area does not fit into message RAM, or
+ * FDCAN_E_BUSY if the block is not in INIT mode.
+ */
+int fdcan_set_ram_layout(uint32_t canport, uint32_t offset,
+		const struct fdcan_ram_layout *layout)
+{
+	unsigned f0_size = fdcan_ram_element_size(layout->rx_fifo0_data);
+	unsigned f1_size = fdcan_ram_element_size(layout->rx_fifo1_data);
+	unsigned rb_size = fdcan_ram_element_size(layout->rx_buffer_data);
+	unsigned tb_size = fdcan_ram_element_size(layout->tx_data);
+	uint32_t flssa, flesa, f0sa, f1sa, rbsa, efsa, tbsa, end;
+	struct fdcan_standard_filter *lfssa;
+	struct fdcan_extended_filter *lfesa;
+
+	if (f0_size == 0 || f1_size == 0 || rb_size == 0 || tb_size == 0) {
+		return FDCAN_E_INVALID;
+	}
+
+	if (layout->std_filters > 128 || layout->ext_filters > 64
+		|| layout->rx_fifo0 > 64 || layout->rx_fifo1 > 64
+		|| layout->rx_buffers > 64 || layout->tx_events > 32
+		|| layout->tx_buffers + layout->tx_fifo > 32
+		|| (offset & 3) != 0) {
+		return FDCAN_E_OUTOFRANGE;
+	}
+
+	flssa = offset;
+	flesa = flssa + layout->std_filters * sizeof(struct fdcan_standard_filter);
+	f0sa = flesa + layout->ext_filters * sizeof(struct fdcan_extended_filter);
+	f1sa = f0sa + layout->rx_fifo0 * f0_size;
+	rbsa = f1sa + layout->rx_fifo1 * f1_size;
+	efsa = rbsa + layout->rx_buffers * rb_size;
+	tbsa = efsa + layout->tx_events * sizeof(struct fdcan_tx_event_element);
+	end = tbsa + (layout->tx_buffers + layout->tx_fifo) * tb_size;
+
+	if (end > CAN_MSG_SIZE) {
+		return FDCAN_E_OUTOFRANGE;
+	}
+
+	fdcan_set_rx_element_size(canport, layout->rx_buffer_data,
+			layout->rx_fifo0_data, layout->rx_fifo1_data);
+	fdcan_set_tx_element_size(canport, layout->tx_data);
+
+	/* Byte addresses, written like RXBC and TXBC below. */
+	FDCAN_SIDFC(canport) = (layout->std_filters << FDCAN_SIDFC_LSS_SHIFT)
+		| (flssa & (FDCAN_SIDFC_FLSSA_MASK << FDCAN_SIDFC_FLSSA_SHIFT));
+	FDCAN_XIDFC(canport) = (layout->ext_filters << FDCAN_XIDFC_LSE_SHIFT)
+		| (flesa & (FDCAN_XIDFC_FLESA_MASK << FDCAN_XIDFC_FLESA_SHIFT));
+	fdcan_init_fifo_ram(canport, 0, f0sa, layout->rx_fifo0);
+	fdcan_init_fifo_ram(canport, 1, f1sa, layout->rx_fifo1);
+	FDCAN_RXBC(canport) = rbsa & (FDCAN_RXBC_RBSA_MASK << FDCAN_RXBC_RBSA_SHIFT);
+	fdcan_init_tx_event_ram(canport, efsa, layout->tx_events);
+	FDCAN_TXBC(canport) = (FDCAN_TXBC(canport) & FDCAN_TXBC_TFQM)
+		| (layout->tx_fifo << FDCAN_TXBC_TFQS_SHIFT)
+		| (layout->tx_buffers << FDCAN_TXBC_NDTB_SHIFT)
+		| (tbsa & (FDCAN_TXBC_TBSA_MASK << FDCAN_TXBC_TBSA_SHIFT));
+
+	/* Configuration registers are only writable in INIT mode. */
+	if (FDCAN_LFSSA_OFFSET(canport) != flssa
+		|| FDCAN_LFESA_OFFSET(canport) != flesa) {
+		return FDCAN_E_BUSY;
+	}
+
+	lfssa = fdcan_get_flssa_addr(canport);
+	lfesa = fdcan_get_flesa_addr(canport);
+
+	for (int q = 0; q < layout->std_filters; ++q) {
+		lfssa[q].type_id1_conf_id2 = 0;
+	}
+
+	for (int q = 0; q < layout->ext_filters; ++q) {
+		lfesa[q].conf_id1 = 0;
+		lfesa[q].type_id2 = 0;
+	}
+
+	return end - offset;
+}
+
 /** Configure amount of filters and initialize filtering block.
  *
  * This function allows to configure global amount of filters present.
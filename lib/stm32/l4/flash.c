@@ -40,7 +40,9 @@
 
 /**@{*/
 
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/stm32/flash.h>
+#include "../common/flash_common_load.h"
 
 /** @brief Wait until Last Operation has Ended
  * This loops indefinitely until an operation (write or erase) has completed
@@ -136,18 +138,86 @@ void flash_program_double_word(uint32_t address, uint64_t data)
 	FLASH_CR &= ~FLASH_CR_PG;
 }
 
+#define FLASH_SR_PROG_ERRORS	(FLASH_SR_FASTERR | FLASH_SR_MISERR | \
+				 FLASH_SR_PGSERR | FLASH_SR_SIZERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR | \
+				 FLASH_SR_PROGERR)
+
+/** @brief Program a row of FLASH in fast programming mode
+ *
+ * Programs FLASH_ROW_SIZE bytes with a single wait for the end of the
+ * operation. Fast programming requires the bank to be mass erased and HCLK
+ * of at least 8MHz, interrupts are disabled while the row is written.
+ *
+ * @param[in] address Row aligned address in Flash.
+ * @param[in] data Pointer to FLASH_ROW_SIZE bytes, any alignment.
+ * @returns true on success, false if an error flag was set
+ */
+bool flash_program_row(uint32_t address, const uint8_t *data)
+{
+	uint32_t i;
+
+	flash_wait_for_last_operation();
+	FLASH_SR = FLASH_SR_PROG_ERRORS | FLASH_SR_EOP;
+
+	/* The row must be written without pauses, see MISERR. */
+	CM_ATOMIC_BLOCK() {
+		FLASH_CR |= FLASH_CR_FSTPG;
+		for (i = 0; i < FLASH_ROW_SIZE; i += 4) {
+			MMIO32(address + i) = flash_load_word(data + i);
+		}
+	}
+	flash_wait_for_last_operation();
+	FLASH_CR &= ~FLASH_CR_FSTPG;
+
+	return !(FLASH_SR & FLASH_SR_PROG_ERRORS);
+}
+
 /** @brief Program a Data Block to FLASH
  * This programs an arbitrary length data block to FLASH memory.
+ * Whole rows are programmed in fast programming mode, the rest and rows that
+ * can't be fast programmed (e.g. the bank wasn't mass erased) a double word at
+ * a time. An incomplete last double word is padded with 0xff.
  * The program error flag should be checked separately for the event that
  * memory was not properly erased.
- * @param[in] address Starting address in Flash.
+ * @param[in] address Starting address in Flash, double word aligned.
  * @param[in] data Pointer to start of data block.
- * @param[in] len Length of data block in bytes (multiple of 8).
+ * @param[in] len Length of data block in bytes.
  */
 void flash_program(uint32_t address, uint8_t *data, uint32_t len)
 {
-	for (uint32_t i = 0; i < len; i += 8) {
-		flash_program_double_word(address+i, *(uint64_t*)(data + i));
+	bool fast = true;
+
+	while (len) {
+		uint8_t dw[8] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+		uint32_t n = (len < 8) ? len : 8;
+		uint32_t lo, hi, i;
+
+		if (fast && (address % FLASH_ROW_SIZE) == 0 &&
+		    len >= FLASH_ROW_SIZE) {
+			if (flash_program_row(address, data)) {
+				address += FLASH_ROW_SIZE;
+				data += FLASH_ROW_SIZE;
+				len -= FLASH_ROW_SIZE;
+				continue;
+			}
+			fast = false;
+			FLASH_SR = FLASH_SR_PROG_ERRORS;
+		}
+
+		for (i = 0; i < n; i++) {
+			dw[i] = data[i];
+		}
+		lo = flash_load_word(dw);
+		hi = flash_load_word(dw + 4);
+		/* Skips what a failed row already programmed */
+		if (MMIO32(address) != lo || MMIO32(address + 4) != hi) {
+			flash_program_double_word(address,
+						  ((uint64_t)hi << 32) | lo);
+		}
+		address += 8;
+		data += n;
+		len -= n;
 	}
 }
 
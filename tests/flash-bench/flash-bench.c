@@ -0,0 +1,153 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Flash execution micro benchmarks. Each workload targets one part of the
+ * flash accelerator:
+ *  linear: straight line code larger than the instruction cache, only the
+ *	prefetch buffer helps.
+ *  loop: a small loop that fits the instruction cache.
+ *  table: constant data read from flash, larger than the data cache.
+ *  lookup: constant data read from flash, small enough for the data cache.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <libopencm3/cm3/dwt.h>
+#include <libopencm3/stm32/flash.h>
+
+#include "flash-bench.h"
+
+#define XS(x)		do {			\
+		x ^= x << 13;			\
+		x ^= x >> 17;			\
+		x ^= x << 5;			\
+	} while (0)
+#define XS4(x)		do {			\
+		XS(x); XS(x); XS(x); XS(x);	\
+	} while (0)
+#define XS32(x)		do {			\
+		XS4(x); XS4(x); XS4(x); XS4(x);	\
+		XS4(x); XS4(x); XS4(x); XS4(x);	\
+	} while (0)
+#define XS256(x)	do {				\
+		XS32(x); XS32(x); XS32(x); XS32(x);	\
+		XS32(x); XS32(x); XS32(x); XS32(x);	\
+	} while (0)
+
+static const uint32_t bench_data[1024] = { 0x12345678, 0x9abcdef0 };
+
+static __attribute__((noinline)) uint32_t bench_linear(uint32_t x)
+{
+	XS256(x);
+	XS256(x);
+	return x;
+}
+
+static __attribute__((noinline)) uint32_t bench_loop(uint32_t x)
+{
+	uint32_t crc = 0xffffffff;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc ^= x + i;
+		for (j = 0; j < 8; j++) {
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+		}
+	}
+	return crc;
+}
+
+static __attribute__((noinline)) uint32_t bench_table(uint32_t x)
+{
+	const volatile uint32_t *p = bench_data;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(bench_data) / 4; i++) {
+		x += p[i];
+	}
+	return x;
+}
+
+static __attribute__((noinline)) uint32_t bench_lookup(uint32_t x)
+{
+	const volatile uint32_t *p = bench_data;
+	int i;
+
+	for (i = 0; i < 1024; i++) {
+		x += p[(x + i) & 7];
+	}
+	return x;
+}
+
+static const struct {
+	const char *name;
+	uint32_t (*fn)(uint32_t x);
+} workloads[] = {
+	{ "linear", bench_linear },
+	{ "loop", bench_loop },
+	{ "table", bench_table },
+	{ "lookup", bench_lookup },
+};
+
+#define WORKLOADS	(sizeof(workloads) / sizeof(workloads[0]))
+
+static uint32_t bench_sink;
+
+void flash_bench_run(uint32_t ws_min, uint32_t ws_max,
+		     const uint32_t *policies, int count)
+{
+	unsigned int w;
+	uint32_t ws;
+	int i;
+
+	if (!dwt_enable_cycle_counter()) {
+		printf("no cycle counter\n");
+		return;
+	}
+
+	printf("ws prften icen dcen");
+	for (w = 0; w < WORKLOADS; w++) {
+		printf(" %8s", workloads[w].name);
+	}
+	printf("\n");
+
+	for (ws = ws_min; ws <= ws_max; ws++) {
+		for (i = 0; i < count; i++) {
+			flash_set_cache_policy(ws, policies[i]);
+			printf("%2" PRIu32 " %6d %4d %4d", ws,
+			       !!(policies[i] & FLASH_ACR_PRFTEN),
+			       !!(policies[i] & FLASH_ACR_ICEN),
+			       !!(policies[i] & FLASH_ACR_DCEN));
+			for (w = 0; w < WORKLOADS; w++) {
+				uint32_t start, cycles;
+
+				/* First run fills the caches. */
+				bench_sink += workloads[w].fn(bench_sink);
+				start = dwt_read_cycle_counter();
+				bench_sink += workloads[w].fn(bench_sink);
+				cycles = dwt_read_cycle_counter() - start;
+				printf(" %8" PRIu32, cycles);
+			}
+			printf("\n");
+		}
+	}
+
+	/* Leave the slowest safe setting with everything on. */
+	flash_set_cache_policy(ws_max, FLASH_ACR_PRFTEN | FLASH_ACR_ICEN |
+				       FLASH_ACR_DCEN);
+}
@@ -0,0 +1,35 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLASH_BENCH_H
+#define FLASH_BENCH_H
+
+#include <stdint.h>
+
+/**
+ * Run all workloads with every policy and wait state combination.
+ * Results are printed as cycles per run, one line per combination.
+ * @param ws_min wait states needed at the current clock, never go lower!
+ * @param ws_max highest wait state setting to try
+ * @param policies FLASH_ACR accelerator bits to try, see
+ *	flash_set_cache_policy()
+ * @param count number of entries in policies
+ */
+void flash_bench_run(uint32_t ws_min, uint32_t ws_max,
+		     const uint32_t *policies, int count);
+
+#endif
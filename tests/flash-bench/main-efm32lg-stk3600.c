@@ -0,0 +1,110 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/efm32/cmu.h>
+#include <libopencm3/efm32/dma.h>
+#include <libopencm3/efm32/gpio.h>
+#include <libopencm3/efm32/msc.h>
+
+#include <stdio.h>
+#include "program-bench.h"
+
+/* Upper half of the efm32lg990f256, the program stays in the lower one. */
+#define BENCH_ADDRESS		0x00020000
+#define BENCH_SIZE		(128 * 1024)
+#define BENCH_CLOCK		48000000
+
+#define BENCH_DMA_CH		DMA_CH0
+
+/* Primary descriptors of all 12 channels, only basic transfers are used. */
+static uint8_t dma_desc[256] __attribute__((aligned(256)));
+
+static void erase_pages(uint32_t arg)
+{
+	uint32_t off;
+
+	(void)arg;
+	for (off = 0; off < BENCH_SIZE; off += MSC_PAGE_SIZE) {
+		msc_erase_page(BENCH_ADDRESS + off);
+	}
+}
+
+static bool program_words(uint32_t arg, uint32_t address,
+			  const uint8_t *data, uint32_t len)
+{
+	const uint32_t *w = (const uint32_t *)data;
+	uint32_t i;
+
+	(void)arg;
+	for (i = 0; i < len / 4; i++) {
+		if (!msc_program_word(address + 4 * i, w[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool program_block(uint32_t arg, uint32_t address,
+			  const uint8_t *data, uint32_t len)
+{
+	(void)arg;
+	return msc_program(address, (const uint32_t *)data, len / 4);
+}
+
+static bool program_block_dma(uint32_t arg, uint32_t address,
+			      const uint8_t *data, uint32_t len)
+{
+	return msc_program_dma((uint32_t)dma_desc, arg, address,
+			       (const uint32_t *)data, len / 4);
+}
+
+static const struct program_bench program_methods[] = {
+	{ "word", erase_pages, program_words, 0 },
+	{ "block", erase_pages, program_block, 0 },
+	{ "block dma", erase_pages, program_block_dma, BENCH_DMA_CH },
+};
+
+/* SWO on PF2 (location 0), clocked by the AUXHFRCO. */
+static void swo_setup(void)
+{
+	cmu_osc_on(AUXHFRCO);
+	cmu_wait_for_osc_ready(AUXHFRCO);
+	cmu_periph_clock_enable(CMU_GPIO);
+	gpio_mode_setup(GPIOF, GPIO_MODE_PUSH_PULL, GPIO2);
+	GPIO_ROUTE = (GPIO_ROUTE & ~GPIO_ROUTE_SWLOCATION_MASK) |
+		     GPIO_ROUTE_SWLOCATION(0) | GPIO_ROUTE_SWOPEN;
+}
+
+int main(void)
+{
+	cmu_clock_setup_in_hfxo_out_48mhz();
+	swo_setup();
+
+	cmu_periph_clock_enable(CMU_DMA);
+	dma_set_desc_address((uint32_t)dma_desc);
+	dma_enable_with_unprivileged_access();
+
+	printf("flash-bench efm32lg-stk3600 %d Hz\n", BENCH_CLOCK);
+
+	msc_unlock();
+	program_bench_run(program_methods,
+			  sizeof(program_methods) / sizeof(program_methods[0]),
+			  BENCH_ADDRESS, BENCH_SIZE, BENCH_CLOCK);
+	msc_lock();
+
+	while (1);
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/rcc.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "flash-bench.h"
+#include "program-bench.h"
+
+/* Start of bank 2 of the stm32l476rg, the program stays in bank 1. */
+#define BENCH_ADDRESS		0x08080000
+#define BENCH_SIZE		(128 * 1024)
+#define BENCH_PAGE_SIZE		2048
+#define BENCH_FIRST_PAGE	256
+
+#define FLASH_SR_ERRORS		(FLASH_SR_FASTERR | FLASH_SR_MISERR | \
+				 FLASH_SR_PGSERR | FLASH_SR_SIZERR | \
+				 FLASH_SR_PGAERR | FLASH_SR_WRPERR | \
+				 FLASH_SR_PROGERR)
+
+static const uint32_t policies[] = {
+	0,
+	FLASH_ACR_PRFTEN,
+	FLASH_ACR_ICEN,
+	FLASH_ACR_DCEN,
+	FLASH_ACR_ICEN | FLASH_ACR_DCEN,
+	FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN,
+};
+
+/* Fast programming wants a mass erased bank. */
+static void erase_bank(uint32_t arg)
+{
+	(void)arg;
+	flash_wait_for_last_operation();
+	flash_clear_status_flags();
+	FLASH_CR |= FLASH_CR_MER2;
+	FLASH_CR |= FLASH_CR_START;
+	flash_wait_for_last_operation();
+	FLASH_CR &= ~FLASH_CR_MER2;
+}
+
+static void erase_pages(uint32_t arg)
+{
+	uint32_t page;
+
+	(void)arg;
+	flash_clear_status_flags();
+	for (page = 0; page < BENCH_SIZE / BENCH_PAGE_SIZE; page++) {
+		flash_erase_page(BENCH_FIRST_PAGE + page);
+	}
+}
+
+static bool program_rows(uint32_t arg, uint32_t address,
+			 const uint8_t *data, uint32_t len)
+{
+	(void)arg;
+	flash_program(address, (uint8_t *)data, len);
+	return !(FLASH_SR & FLASH_SR_ERRORS);
+}
+
+static bool program_double_words(uint32_t arg, uint32_t address,
+				 const uint8_t *data, uint32_t len)
+{
+	const uint32_t *w = (const uint32_t *)data;
+	uint32_t i;
+
+	(void)arg;
+	for (i = 0; i < len / 4; i += 2) {
+		flash_program_double_word(address + 4 * i,
+					  w[i] | ((uint64_t)w[i + 1] << 32));
+	}
+	return !(FLASH_SR & FLASH_SR_ERRORS);
+}
+
+/* After a page erase the rows fail and flash_program() falls back to
+ * double words, "row, pages" shows what that costs. */
+static const struct program_bench program_methods[] = {
+	{ "row", erase_bank, program_rows, 0 },
+	{ "double word", erase_bank, program_double_words, 0 },
+	{ "row, pages", erase_pages, program_rows, 0 },
+};
+
+int main(void)
+{
+	const struct rcc_clock_scale *clock =
+		&rcc_hsi16_configs[RCC_CLOCK_VRANGE1_80MHZ];
+
+	rcc_clock_setup_pll(clock);
+
+	printf("flash-bench nucleo-l476rg %" PRIu32 " Hz\n", rcc_ahb_frequency);
+	flash_bench_run(clock->flash_config & FLASH_ACR_LATENCY_MASK, 4,
+			policies, sizeof(policies) / sizeof(policies[0]));
+
+	flash_unlock();
+	program_bench_run(program_methods,
+			  sizeof(program_methods) / sizeof(program_methods[0]),
+			  BENCH_ADDRESS, BENCH_SIZE, rcc_ahb_frequency);
+	flash_lock();
+
+	while (1);
+}
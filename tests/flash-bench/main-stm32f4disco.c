@@ -0,0 +1,83 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/rcc.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "flash-bench.h"
+#include "program-bench.h"
+
+/* Last 128 KiB sector of the stm32f405re, far past the program. */
+#define BENCH_SECTOR		7
+#define BENCH_SECTOR_ADDRESS	0x08060000
+#define BENCH_SECTOR_SIZE	(128 * 1024)
+
+static const uint32_t policies[] = {
+	0,
+	FLASH_ACR_PRFTEN,
+	FLASH_ACR_ICEN,
+	FLASH_ACR_DCEN,
+	FLASH_ACR_ICEN | FLASH_ACR_DCEN,
+	FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN,
+};
+
+static void erase_sector(uint32_t psize)
+{
+	(void)psize;
+	flash_erase_sector(BENCH_SECTOR, FLASH_CR_PROGRAM_X32);
+}
+
+static bool program_block(uint32_t psize, uint32_t address,
+			  const uint8_t *data, uint32_t len)
+{
+	flash_set_program_parallelism(psize);
+	flash_program(address, data, len);
+	return !(FLASH_SR & (FLASH_SR_PGSERR | FLASH_SR_PGPERR |
+			     FLASH_SR_PGAERR | FLASH_SR_WRPERR));
+}
+
+/* x64 needs VPP on the board, without it the first write fails. */
+static const struct program_bench program_methods[] = {
+	{ "program x8", erase_sector, program_block, FLASH_CR_PROGRAM_X8 },
+	{ "program x16", erase_sector, program_block, FLASH_CR_PROGRAM_X16 },
+	{ "program x32", erase_sector, program_block, FLASH_CR_PROGRAM_X32 },
+	{ "program x64", erase_sector, program_block, FLASH_CR_PROGRAM_X64 },
+};
+
+int main(void)
+{
+	const struct rcc_clock_scale *clock =
+		&rcc_hse_8mhz_3v3[RCC_CLOCK_3V3_168MHZ];
+
+	rcc_clock_setup_pll(clock);
+
+	printf("flash-bench stm32f4disco %" PRIu32 " Hz\n", rcc_ahb_frequency);
+	flash_bench_run(clock->flash_config & FLASH_ACR_LATENCY_MASK, 7,
+			policies, sizeof(policies) / sizeof(policies[0]));
+
+	flash_unlock();
+	program_bench_run(program_methods,
+			  sizeof(program_methods) / sizeof(program_methods[0]),
+			  BENCH_SECTOR_ADDRESS, BENCH_SECTOR_SIZE,
+			  rcc_ahb_frequency);
+	flash_set_program_parallelism(FLASH_CR_PROGRAM_X8);
+	flash_lock();
+
+	while (1);
+}
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Flash programming throughput. The family specific erase and program
+ * methods come from the board's main file, this only times and verifies.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <libopencm3/cm3/dwt.h>
+
+#include "program-bench.h"
+
+/* Words, so that methods taking aligned data can use it as is. */
+static uint32_t bench_chunk[PROGRAM_BENCH_CHUNK / 4];
+
+static bool program_bench_verify(uint32_t address, uint32_t size)
+{
+	uint32_t off;
+
+	for (off = 0; off < size; off += PROGRAM_BENCH_CHUNK) {
+		if (memcmp((const void *)(address + off), bench_chunk,
+			   PROGRAM_BENCH_CHUNK)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void program_bench_run(const struct program_bench *methods, int count,
+		       uint32_t address, uint32_t size, uint32_t hz)
+{
+	uint32_t x = 0x2545f491;
+	unsigned int i;
+	int m;
+
+	if (!dwt_enable_cycle_counter()) {
+		printf("no cycle counter\n");
+		return;
+	}
+
+	/* Random data, no erased (all ones) words the flash could skip. */
+	for (i = 0; i < PROGRAM_BENCH_CHUNK / 4; i++) {
+		x = x * 1664525 + 1013904223;
+		bench_chunk[i] = x;
+	}
+
+	printf("%-12s %10s %8s\n", "method", "cycles", "KiB/s");
+	for (m = 0; m < count; m++) {
+		const struct program_bench *b = &methods[m];
+		uint32_t start, cycles, off;
+		bool ok = true;
+
+		b->erase(b->arg);
+		start = dwt_read_cycle_counter();
+		for (off = 0; ok && off < size; off += PROGRAM_BENCH_CHUNK) {
+			ok = b->program(b->arg, address + off,
+					(const uint8_t *)bench_chunk,
+					PROGRAM_BENCH_CHUNK);
+		}
+		cycles = dwt_read_cycle_counter() - start;
+
+		if (!ok || !program_bench_verify(address, size)) {
+			printf("%-12s %10s\n", b->name, "failed");
+			continue;
+		}
+		printf("%-12s %10" PRIu32 " %8" PRIu32 "\n", b->name, cycles,
+		       (uint32_t)((uint64_t)size * hz / cycles / 1024));
+	}
+}
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the libopencm3 project.
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROGRAM_BENCH_H
+#define PROGRAM_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Bytes handed to a program method per call, the data is word aligned. */
+#define PROGRAM_BENCH_CHUNK	2048
+
+/** A way of programming flash, timed by program_bench_run(). */
+struct program_bench {
+	const char *name;
+	/** Erase the whole area, not timed */
+	void (*erase)(uint32_t arg);
+	/** Program len bytes, return false on a programming error */
+	bool (*program)(uint32_t arg, uint32_t address, const uint8_t *data,
+			uint32_t len);
+	uint32_t arg;		/**< passed to erase and program */
+};
+
+/**
+ * Erase the area, program it chunk by chunk and verify it with every method.
+ * Results are printed as cycles and KiB/s, one line per method.
+ * The flash must be unlocked.
+ * @param methods methods to time
+ * @param count number of entries in methods
+ * @param address start of the area, must not hold the running program!
+ * @param size size of the area, a multiple of PROGRAM_BENCH_CHUNK
+ * @param hz core clock, to convert cycles to throughput
+ */
+void program_bench_run(const struct program_bench *methods, int count,
+		       uint32_t address, uint32_t size, uint32_t hz);
+
+#endif